@@ -0,0 +1,144 @@
+#include "arena.h"
+#include "keytable.h"
+
+#include <atomic>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace json
+{
+  namespace
+  {
+    struct Block
+    {
+      Arena* owner;
+      Block* next;
+    };
+
+    constexpr std::size_t HeaderSize = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    Block* AllocateBlock(std::size_t size)
+    {
+      void* memory = nullptr;
+#ifdef _WIN32
+      memory = _aligned_malloc(size, Arena::ChunkSize);
+#else
+      if (posix_memalign(&memory, Arena::ChunkSize, size) != 0)
+        memory = nullptr;
+#endif
+      if (memory == nullptr)
+        throw std::bad_alloc();
+      return (Block*)memory;
+    }
+
+    void FreeBlock(Block* block)
+    {
+#ifdef _WIN32
+      _aligned_free(block);
+#else
+      std::free(block);
+#endif
+    }
+  } // namespace
+
+  Arena::~Arena()
+  {
+    reset();
+    delete m_Keys;
+  }
+
+  Arena::Marker Arena::mark() const
+  {
+    return {m_Blocks, m_Current, m_Top, m_Keys ? m_Keys->size() : 0};
+  }
+
+  KeyTable& Arena::getKeys()
+  {
+    if (m_Keys == nullptr)
+      m_Keys = new KeyTable(*this);
+    return *m_Keys;
+  }
+
+  void Arena::shareKeys(Arena& owner)
+  {
+    delete m_Keys;
+    m_Keys = new KeyTable(*this, owner.m_Keys);
+  }
+
+  void* Arena::allocateSlow(std::size_t size, std::size_t align)
+  {
+    if (size + align > ChunkSize / 4)
+    {
+      // Big arrays and strings get a block of their own which is linked behind the current chunk so that it does not
+      // interrupt bump allocation.
+      Block* block = AllocateBlock(HeaderSize + size + align);
+      block->owner = this;
+      block->next = (Block*)m_Blocks;
+      m_Blocks = block;
+      return (void*)(((uintptr_t)block + HeaderSize + align - 1) & ~(uintptr_t)(align - 1));
+    }
+
+    Block* chunk = AllocateBlock(ChunkSize);
+    chunk->owner = this;
+    chunk->next = (Block*)m_Blocks;
+    m_Blocks = chunk;
+    m_Current = chunk;
+    m_Top = (char*)chunk + HeaderSize;
+    m_End = (char*)chunk + ChunkSize;
+    return allocate(size, align);
+  }
+
+  void Arena::rewind(const Marker& marker)
+  {
+    touch();
+    if (m_Keys) // before the key nodes are released
+      m_Keys->truncate(marker.keyCount);
+    while (m_Blocks != marker.blocks)
+    {
+      Block* block = (Block*)m_Blocks;
+      m_Blocks = block->next;
+      FreeBlock(block);
+    }
+    m_Current = marker.current;
+    m_Top = marker.top;
+    m_End = m_Current ? (char*)m_Current + ChunkSize : nullptr;
+  }
+
+  void Arena::adopt(Arena& other)
+  {
+    if (other.m_Blocks == nullptr)
+      return;
+    touch();
+    other.touch();
+    // The adopted blocks go in front of the list so that the current chunk stays the one being bump allocated from.
+    if (other.m_Keys)
+      getKeys().merge(*other.m_Keys);
+    Block* last = (Block*)other.m_Blocks;
+    last->owner = this;
+    while (last->next != nullptr)
+    {
+      last = last->next;
+      last->owner = this;
+    }
+    last->next = (Block*)m_Blocks;
+    m_Blocks = other.m_Blocks;
+    other.m_Blocks = nullptr;
+    other.m_Current = nullptr;
+    other.m_Top = nullptr;
+    other.m_End = nullptr;
+  }
+
+  uint64_t Arena::NextGeneration()
+  {
+    static std::atomic<uint64_t> generations{0};
+    return ++generations;
+  }
+
+  Arena* Arena::Of(const void* ptr)
+  {
+    return ((Block*)((uintptr_t)ptr & ~(uintptr_t)(ChunkSize - 1)))->owner;
+  }
+} // namespace json
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+namespace json
+{
+  class KeyTable;
+  class Node;
+
+  /**
+   * @brief A bump allocator owning every node, member, array and string of one json document. Memory is handed out
+   * from fixed size chunks aligned to their size, which lets any object allocated in a chunk find its arena from its
+   * own address. Nothing is freed individually, the whole arena is released at once.
+   */
+  class Arena
+  {
+  public:
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    /**
+     * @brief A position in the arena that allocations can be rolled back to.
+     */
+    struct Marker
+    {
+      void* blocks;
+      void* current;
+      char* top;
+      std::size_t keyCount; // keys interned so far
+    };
+
+    Arena() = default;
+    ~Arena();
+
+    Arena(const Arena& other) = delete;
+    Arena& operator=(const Arena& other) = delete;
+
+    /**
+     * @brief Allocates uninitialized memory. Allocations bigger than a quarter of a chunk get a block of their own.
+     *
+     * @param size Size in bytes.
+     * @param align Required alignment, must be a power of two.
+     * @return void*
+     */
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+    {
+      char* ptr = (char*)(((uintptr_t)m_Top + align - 1) & ~(uintptr_t)(align - 1));
+      if (ptr + size > m_End || m_Top == nullptr)
+        return allocateSlow(size, align);
+      m_Top = ptr + size;
+      return ptr;
+    }
+
+    /**
+     * @brief Default constructs an object inside the arena. Its destructor is never called.
+     */
+    template <typename T>
+    T* create()
+    {
+      return new (allocate(sizeof(T), alignof(T))) T();
+    }
+
+    /**
+     * @brief Allocates an uninitialized array inside the arena.
+     */
+    template <typename T>
+    T* allocateArray(std::size_t count)
+    {
+      return (T*)allocate(sizeof(T) * count, alignof(T));
+    }
+
+    /**
+     * @brief Copies a string into the arena and null terminates it.
+     *
+     * @param str The characters to copy.
+     * @return char*
+     */
+    char* copyString(std::string_view str)
+    {
+      char* result = (char*)allocate(str.size() + 1, 1);
+      std::memcpy(result, str.data(), str.size());
+      result[str.size()] = '\0';
+      return result;
+    }
+
+    /**
+     * @brief Returns the current position which can later be passed to rewind().
+     */
+    Marker mark() const;
+
+    /**
+     * @brief Releases everything allocated after the marker was taken.
+     */
+    void rewind(const Marker& marker);
+
+    /**
+     * @brief Releases everything allocated in the arena.
+     */
+    void reset()
+    {
+      rewind(Marker{nullptr, nullptr, nullptr, 0});
+    }
+
+    /**
+     * @brief Takes over every block of another arena, which is left empty. Objects allocated by the other arena stay
+     * where they are and belong to this arena from now on, rewinding to a marker taken before the call releases them.
+     * The keys of the other arena are added to the key table of this one. Keys this one already has are not merged,
+     * so arenas whose documents end up in one should intern their keys through a shared table, see shareKeys().
+     *
+     * @param other The arena whose blocks are taken.
+     */
+    void adopt(Arena& other);
+
+    /**
+     * @brief Returns the arena an object was allocated in. Only valid for objects no bigger than a quarter of a chunk
+     * that were allocated by an arena.
+     */
+    static Arena* Of(const void* ptr);
+
+    /**
+     * @brief Returns the table interning the keys of the documents in the arena, creating it on first use. Not thread
+     * safe, call it once before handing the arena to other threads.
+     *
+     * @return KeyTable&
+     */
+    KeyTable& getKeys();
+
+    /**
+     * @brief Returns the key table, or nullptr if no key has been interned in the arena.
+     *
+     * @return const KeyTable*
+     */
+    const KeyTable* findKeys() const
+    {
+      return m_Keys;
+    }
+
+    /**
+     * @brief Makes this arena intern its keys through the table of another arena, so that documents parsed into both
+     * on different threads share the key nodes. The key nodes are allocated in the other arena, which must not be used
+     * by another thread meanwhile and must have created its table already.
+     *
+     * @param owner The arena owning the shared table.
+     */
+    void shareKeys(Arena& owner);
+
+    /**
+     * @brief Returns the generation of the documents in the arena. It changes whenever they are changed and no two
+     * arenas ever share one, so whatever was looked up in a document is still there while the generation is the same.
+     *
+     * @return uint64_t
+     */
+    uint64_t getGeneration() const
+    {
+      return m_Generation;
+    }
+
+    /**
+     * @brief Starts a new generation, call it whenever a document in the arena is changed.
+     */
+    void touch()
+    {
+      m_Generation = NextGeneration();
+    }
+
+    Node* getRoot() const
+    {
+      return m_Root;
+    }
+    void setRoot(Node* root)
+    {
+      m_Root = root;
+    }
+
+  private:
+    void* allocateSlow(std::size_t size, std::size_t align);
+    static uint64_t NextGeneration();
+
+  private:
+    void* m_Blocks = nullptr;  // every block, newest first
+    void* m_Current = nullptr; // the chunk m_Top points into
+    char* m_Top = nullptr;
+    char* m_End = nullptr;
+    Node* m_Root = nullptr;
+    KeyTable* m_Keys = nullptr;
+    uint64_t m_Generation = NextGeneration();
+  };
+} // namespace json
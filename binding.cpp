@@ -0,0 +1,194 @@
+#include "binding.h"
+#include "lexer.h"
+
+#include <cstring>
+
+namespace json
+{
+  StructReader::StructReader(std::string_view text, const ParseOptions& options)
+    : m_Begin(text.data()), m_End(text.data() + text.size()), m_Pos(text.data()), m_MaxDepth(options.maxDepth)
+  {
+  }
+
+  void StructReader::enter(char open)
+  {
+    expect(open);
+    if (++m_Depth > m_MaxDepth)
+      error(m_Pos - 1, "at most " + std::to_string(m_MaxDepth) + " nested values");
+  }
+
+  bool StructReader::consumeNull()
+  {
+    skipWhitespace();
+    if (m_End - m_Pos < 4 || std::memcmp(m_Pos, "null", 4) != 0)
+      return false;
+    m_Pos += 4;
+    return true;
+  }
+
+  bool StructReader::readBool()
+  {
+    skipWhitespace();
+    if (m_End - m_Pos >= 4 && std::memcmp(m_Pos, "true", 4) == 0)
+    {
+      m_Pos += 4;
+      return true;
+    }
+    if (m_End - m_Pos >= 5 && std::memcmp(m_Pos, "false", 5) == 0)
+    {
+      m_Pos += 5;
+      return false;
+    }
+    error("true/false");
+  }
+
+  double StructReader::readDouble()
+  {
+    NumberParser::Result number = readNumber();
+    switch (number.kind)
+    {
+    case NumberParser::Kind::Integer:
+      return (double)number.integer;
+    case NumberParser::Kind::Unsigned:
+      return (double)number.unsignedInteger;
+    default:
+      return number.dbl;
+    }
+  }
+
+  NumberParser::Result StructReader::readNumber()
+  {
+    skipWhitespace();
+    if (m_Pos == m_End || !Lexer::IsNumber(*m_Pos))
+      error("number");
+    NumberParser::Result number = NumberParser::Parse(m_Pos, m_End, true);
+    m_Pos = number.end;
+    if (number.expected != nullptr)
+      error(number.expected);
+    return number;
+  }
+
+  std::string_view StructReader::readString()
+  {
+    skipWhitespace();
+    if (m_Pos == m_End || *m_Pos != '"')
+      error("\"");
+    const char* start = m_Pos + 1;
+    const char* pos = start;
+    bool escaped = false;
+    while (true)
+    {
+      pos += StringScanner::FindSpecial(pos, m_End, '"');
+      if (pos == m_End)
+        error(pos, "\"");
+      if (*pos == '"')
+        break;
+      if (*pos != '\\')
+        error(pos, "string character");
+      escaped = true;
+      pos += m_End - pos > 1 ? 2 : 1;
+    }
+    m_Pos = pos + 1;
+    if (!escaped)
+      return std::string_view(start, pos - start);
+
+    m_Scratch.resize(pos - start); // escapes never decode to more bytes than they take
+    char* out = &m_Scratch[0];
+    const char* in = start;
+    while (in < pos)
+    {
+      if (*in != '\\')
+      {
+        *out++ = *in++;
+        continue;
+      }
+      if (!StringScanner::DecodeEscape(in, pos, out, '"'))
+        error(in, "escape sequence");
+    }
+    return std::string_view(m_Scratch.data(), out - m_Scratch.data());
+  }
+
+  void StructReader::skipValue()
+  {
+    // The brackets still to be closed, innermost last. Kept here instead of recursing so that the depth limit holds.
+    std::string closers;
+    while (true)
+    {
+      skipWhitespace();
+      if (m_Pos == m_End)
+        error("object/array/string/true/false/number/null");
+      switch (*m_Pos)
+      {
+      case '{':
+      case '[': {
+        char close = *m_Pos == '{' ? '}' : ']';
+        enter(*m_Pos);
+        if (consume(close))
+        {
+          leave();
+          break;
+        }
+        closers.push_back(close);
+        if (close == '}')
+        {
+          readString();
+          expect(':');
+        }
+        continue;
+      }
+      case '"':
+        readString();
+        break;
+      case 't':
+      case 'f':
+        readBool();
+        break;
+      case 'n':
+        if (!consumeNull())
+          error("null");
+        break;
+      default:
+        readNumber();
+        break;
+      }
+
+      // A value has ended, close every container that ends with it.
+      while (!closers.empty())
+      {
+        if (consume(closers.back()))
+        {
+          closers.pop_back();
+          leave();
+          continue;
+        }
+        expect(',');
+        if (closers.back() == '}')
+        {
+          readString();
+          expect(':');
+        }
+        break;
+      }
+      if (closers.empty())
+        return;
+    }
+  }
+
+  void StructReader::finish()
+  {
+    skipWhitespace();
+    if (m_Pos != m_End)
+      error("EOF");
+  }
+
+  void StructReader::error(const char* position, const std::string& expected) const
+  {
+    std::string_view text(m_Begin, m_End - m_Begin);
+    uint32_t line, column;
+    Lexer::GetPosition(text, position - m_Begin, line, column);
+    std::string got(position < m_End ? std::string(1, *position) : std::string());
+    throw std::runtime_error("Unexpected character at " + std::to_string(line) + ":" + std::to_string(column) +
+                             ". Expected \"" + expected + "\" got " + (got.empty() ? "blank" : got) + ".\n");
+  }
+
+} // namespace json
@@ -0,0 +1,600 @@
+#pragma once
+
+#include "json.h"
+#include "mappedfile.h"
+#include "numberparser.h"
+#include "stringscanner.h"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Registers the public fields of a struct with the binding layer, see StructBinding. Use it at namespace scope
+ * in the namespace of the struct, after its definition. At most 32 fields can be listed, the json keys are the field
+ * names.
+ *
+ *   struct Point { double x, y; std::string label; };
+ *   JSON_FIELDS(Point, x, y, label)
+ */
+#define JSON_FIELDS(Type, ...)                                                                                         \
+  [[maybe_unused]] constexpr auto JsonFieldsOf(const Type*)                                                            \
+  {                                                                                                                    \
+    return std::make_tuple(                                                                                            \
+      JSON_FIELDS_EXPAND(JSON_FIELDS_CONCAT(JSON_FIELDS_, JSON_FIELDS_COUNT(__VA_ARGS__))(Type, __VA_ARGS__)));        \
+  }
+
+#define JSON_FIELDS_FIELD(T, f) ::json::MakeField(#f, &T::f)
+#define JSON_FIELDS_EXPAND(x) x
+#define JSON_FIELDS_CONCAT(a, b) JSON_FIELDS_CONCAT_(a, b)
+#define JSON_FIELDS_CONCAT_(a, b) a##b
+#define JSON_FIELDS_1(T, f) JSON_FIELDS_FIELD(T, f)
+#define JSON_FIELDS_2(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_1(T, __VA_ARGS__))
+#define JSON_FIELDS_3(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_2(T, __VA_ARGS__))
+#define JSON_FIELDS_4(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_3(T, __VA_ARGS__))
+#define JSON_FIELDS_5(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_4(T, __VA_ARGS__))
+#define JSON_FIELDS_6(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_5(T, __VA_ARGS__))
+#define JSON_FIELDS_7(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_6(T, __VA_ARGS__))
+#define JSON_FIELDS_8(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_7(T, __VA_ARGS__))
+#define JSON_FIELDS_9(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_8(T, __VA_ARGS__))
+#define JSON_FIELDS_10(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_9(T, __VA_ARGS__))
+#define JSON_FIELDS_11(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_10(T, __VA_ARGS__))
+#define JSON_FIELDS_12(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_11(T, __VA_ARGS__))
+#define JSON_FIELDS_13(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_12(T, __VA_ARGS__))
+#define JSON_FIELDS_14(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_13(T, __VA_ARGS__))
+#define JSON_FIELDS_15(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_14(T, __VA_ARGS__))
+#define JSON_FIELDS_16(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_15(T, __VA_ARGS__))
+#define JSON_FIELDS_17(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_16(T, __VA_ARGS__))
+#define JSON_FIELDS_18(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_17(T, __VA_ARGS__))
+#define JSON_FIELDS_19(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_18(T, __VA_ARGS__))
+#define JSON_FIELDS_20(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_19(T, __VA_ARGS__))
+#define JSON_FIELDS_21(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_20(T, __VA_ARGS__))
+#define JSON_FIELDS_22(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_21(T, __VA_ARGS__))
+#define JSON_FIELDS_23(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_22(T, __VA_ARGS__))
+#define JSON_FIELDS_24(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_23(T, __VA_ARGS__))
+#define JSON_FIELDS_25(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_24(T, __VA_ARGS__))
+#define JSON_FIELDS_26(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_25(T, __VA_ARGS__))
+#define JSON_FIELDS_27(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_26(T, __VA_ARGS__))
+#define JSON_FIELDS_28(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_27(T, __VA_ARGS__))
+#define JSON_FIELDS_29(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_28(T, __VA_ARGS__))
+#define JSON_FIELDS_30(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_29(T, __VA_ARGS__))
+#define JSON_FIELDS_31(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_30(T, __VA_ARGS__))
+#define JSON_FIELDS_32(T, f, ...) JSON_FIELDS_FIELD(T, f), JSON_FIELDS_EXPAND(JSON_FIELDS_31(T, __VA_ARGS__))
+#define JSON_FIELDS_NTH(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, \
+                        _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...)                           \
+  N
+#define JSON_FIELDS_COUNT(...)                                                                                         \
+  JSON_FIELDS_EXPAND(JSON_FIELDS_NTH(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, \
+                                     15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+
+namespace json
+{
+  /**
+   * @brief A field registered with JSON_FIELDS: its json key and a pointer to the member.
+   */
+  template <typename Struct, typename Member>
+  struct BoundField
+  {
+    using Type = Member;
+
+    const char* name;
+    Member Struct::*member;
+  };
+
+  template <typename Struct, typename Member>
+  constexpr BoundField<Struct, Member> MakeField(const char* name, Member Struct::*member)
+  {
+    return BoundField<Struct, Member>{name, member};
+  }
+
+  /**
+   * @brief A perfect hash of the field names of a struct, built at compile time. Every name gets a slot of its own, so
+   * looking a key up costs one hash and one comparison no matter how many fields there are.
+   */
+  template <std::size_t Count>
+  struct FieldTable
+  {
+    static_assert(Count > 0 && Count < 256, "a bound struct needs between 1 and 255 fields");
+
+    /**
+     * @brief Number of slots, a power of two of at least Count * Count so that a collision free seed is found quickly.
+     */
+    static constexpr std::size_t Size = []() {
+      std::size_t size = 1;
+      while (size < Count * Count)
+        size *= 2;
+      return size;
+    }();
+
+    std::array<std::string_view, Count> names{};
+    std::array<uint8_t, Size> slots{}; // index + 1 of the field hashed there, 0 if none
+    uint32_t seed = 0;
+
+    /**
+     * @brief FNV-1a of the key, started from the seed.
+     */
+    static constexpr uint32_t Hash(std::string_view key, uint32_t seed)
+    {
+      uint32_t hash = 2166136261u ^ seed;
+      for (char c : key)
+      {
+        hash ^= (uint8_t)c;
+        hash *= 16777619u;
+      }
+      return hash ^ (hash >> 16);
+    }
+
+    /**
+     * @brief Returns the index of the field with that name, Count if there is none.
+     */
+    constexpr std::size_t find(std::string_view key) const
+    {
+      uint8_t slot = slots[Hash(key, seed) & (Size - 1)];
+      if (slot == 0 || names[slot - 1] != key)
+        return Count;
+      return slot - 1;
+    }
+
+    /**
+     * @brief Tries seeds until every name hashes to a slot of its own. Fails to compile if a name is listed twice.
+     */
+    static constexpr FieldTable Make(const std::array<std::string_view, Count>& names)
+    {
+      for (std::size_t i = 0; i < Count; i++)
+        for (std::size_t j = i + 1; j < Count; j++)
+          if (names[i] == names[j])
+            throw std::logic_error("a field is bound twice");
+
+      FieldTable table;
+      table.names = names;
+      for (uint32_t seed = 0;; seed++)
+      {
+        bool collided = false;
+        table.slots = {};
+        for (std::size_t i = 0; i < Count && !collided; i++)
+        {
+          uint8_t& slot = table.slots[Hash(names[i], seed) & (Size - 1)];
+          collided = slot != 0;
+          slot = (uint8_t)(i + 1);
+        }
+        if (!collided)
+        {
+          table.seed = seed;
+          return table;
+        }
+      }
+    }
+  };
+
+  /**
+   * @brief Reads json values straight from the text for the binders, without building nodes. The grammar is strict
+   * RFC 8259 apart from not validating UTF-8. Errors are thrown with the same message the parser uses.
+   */
+  class StructReader
+  {
+  public:
+    /**
+     * @brief Construct a new StructReader object
+     *
+     * @param text The json text.
+     * @param options Only maxDepth is used, it limits how deep recursive structs and nested containers may go.
+     */
+    StructReader(std::string_view text, const ParseOptions& options = ParseOptions());
+
+    void skipWhitespace()
+    {
+      while (m_Pos < m_End && (*m_Pos == ' ' || *m_Pos == '\n' || *m_Pos == '\r' || *m_Pos == '\t'))
+        m_Pos++;
+    }
+
+    /**
+     * @brief Moves past the character if it is the next one after whitespace.
+     *
+     * @return Whether it was.
+     */
+    bool consume(char c)
+    {
+      skipWhitespace();
+      if (m_Pos < m_End && *m_Pos == c)
+      {
+        m_Pos++;
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * @brief Moves past the character, throws if it is not the next one after whitespace.
+     */
+    void expect(char c)
+    {
+      if (!consume(c))
+        error(std::string(1, c));
+    }
+
+    /**
+     * @brief Moves past the opening bracket of an array or object. Throws if it is missing or opens more than
+     * ParseOptions::maxDepth containers.
+     */
+    void enter(char open);
+
+    /**
+     * @brief Called once the closing bracket of the innermost container has been moved past.
+     */
+    void leave()
+    {
+      m_Depth--;
+    }
+
+    /**
+     * @brief Moves past a null if it is next.
+     *
+     * @return Whether it was.
+     */
+    bool consumeNull();
+
+    bool readBool();
+
+    double readDouble();
+
+    /**
+     * @brief Reads an integer. Throws if the number has a fraction or exponent, or does not fit in T.
+     */
+    template <typename T>
+    T readInteger()
+    {
+      skipWhitespace();
+      const char* start = m_Pos;
+      NumberParser::Result number = readNumber();
+      if (number.kind == NumberParser::Kind::Double)
+        error(start, "integer");
+      if (number.kind == NumberParser::Kind::Unsigned)
+      {
+        if (!std::is_unsigned_v<T> || number.unsignedInteger > std::numeric_limits<T>::max())
+          error(start, "integer in range");
+        return (T)number.unsignedInteger;
+      }
+      if constexpr (std::is_unsigned_v<T>)
+      {
+        if (number.integer < 0 || (uint64_t)number.integer > std::numeric_limits<T>::max())
+          error(start, "integer in range");
+      }
+      else if (number.integer < std::numeric_limits<T>::min() || number.integer > std::numeric_limits<T>::max())
+        error(start, "integer in range");
+      return (T)number.integer;
+    }
+
+    /**
+     * @brief Reads a string. Strings without escape sequences point into the text, the others into a buffer that is
+     * reused by the next string.
+     *
+     * @return std::string_view
+     */
+    std::string_view readString();
+
+    /**
+     * @brief Moves past a value of any type, checking its grammar. Used for keys that are not bound.
+     */
+    void skipValue();
+
+    /**
+     * @brief Throws if anything but whitespace is left.
+     */
+    void finish();
+
+    /**
+     * @brief Throws a parse error at the current position.
+     *
+     * @param expected What was expected there.
+     */
+    [[noreturn]] void error(const std::string& expected) const
+    {
+      error(m_Pos, expected);
+    }
+
+  private:
+    NumberParser::Result readNumber();
+    [[noreturn]] void error(const char* position, const std::string& expected) const;
+
+  private:
+    const char* m_Begin;
+    const char* m_End;
+    const char* m_Pos;
+    std::size_t m_Depth = 0;
+    std::size_t m_MaxDepth;
+    std::string m_Scratch; // decoded strings
+  };
+
+  /**
+   * @brief Reads and writes a type as json. Specialized for bool, arithmetic types, std::string, std::vector,
+   * std::optional and structs registered with JSON_FIELDS. Specialize it to bind other types.
+   */
+  template <typename T, typename Enable = void>
+  struct JsonBinder;
+
+  template <typename T, typename = void>
+  struct HasJsonFields : std::false_type
+  {
+  };
+
+  template <typename T>
+  struct HasJsonFields<T, std::void_t<decltype(JsonFieldsOf(static_cast<const T*>(nullptr)))>> : std::true_type
+  {
+  };
+
+  template <>
+  struct JsonBinder<bool>
+  {
+    static void Read(StructReader& reader, bool& value)
+    {
+      value = reader.readBool();
+    }
+    static void Write(std::ostream& output, bool value)
+    {
+      output << (value ? "true" : "false");
+    }
+  };
+
+  template <typename T>
+  struct JsonBinder<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+  {
+    static void Read(StructReader& reader, T& value)
+    {
+      value = reader.readInteger<T>();
+    }
+    static void Write(std::ostream& output, T value)
+    {
+      char buffer[24];
+      char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+      output.write(buffer, end - buffer);
+    }
+  };
+
+  template <typename T>
+  struct JsonBinder<T, std::enable_if_t<std::is_floating_point_v<T>>>
+  {
+    static void Read(StructReader& reader, T& value)
+    {
+      value = (T)reader.readDouble();
+    }
+    static void Write(std::ostream& output, T value)
+    {
+      if (!std::isfinite(value)) // json has no infinities or NaN
+      {
+        output << "null";
+        return;
+      }
+      char buffer[32];
+      char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr; // shortest exact round trip of T
+      output.write(buffer, end - buffer);
+    }
+  };
+
+  template <>
+  struct JsonBinder<std::string>
+  {
+    static void Read(StructReader& reader, std::string& value)
+    {
+      value.assign(reader.readString());
+    }
+    static void Write(std::ostream& output, const std::string& value)
+    {
+      StringScanner::WriteQuoted(output, value);
+    }
+  };
+
+  template <typename T>
+  struct JsonBinder<std::vector<T>>
+  {
+    static void Read(StructReader& reader, std::vector<T>& value)
+    {
+      value.clear();
+      reader.enter('[');
+      if (!reader.consume(']'))
+      {
+        do
+        {
+          if constexpr (std::is_same_v<T, bool>)
+            value.push_back(reader.readBool());
+          else
+            JsonBinder<T>::Read(reader, value.emplace_back());
+        } while (reader.consume(','));
+        reader.expect(']');
+      }
+      reader.leave();
+    }
+    static void Write(std::ostream& output, const std::vector<T>& value)
+    {
+      output << '[';
+      for (std::size_t i = 0; i < value.size(); i++)
+      {
+        if (i != 0)
+          output << ',';
+        JsonBinder<T>::Write(output, value[i]);
+      }
+      output << ']';
+    }
+  };
+
+  template <typename T>
+  struct JsonBinder<std::optional<T>>
+  {
+    static void Read(StructReader& reader, std::optional<T>& value)
+    {
+      if (reader.consumeNull())
+        value.reset();
+      else
+        JsonBinder<T>::Read(reader, value.emplace());
+    }
+    static void Write(std::ostream& output, const std::optional<T>& value)
+    {
+      if (value)
+        JsonBinder<T>::Write(output, *value);
+      else
+        output << "null";
+    }
+  };
+
+  /**
+   * @brief Binds a struct registered with JSON_FIELDS. Keys are looked up in a perfect hash built at compile time and
+   * dispatched to the reader of their field through a table of functions. Keys that are not bound are skipped, fields
+   * whose key is missing keep their value and a repeated key overwrites the field.
+   */
+  template <typename T>
+  struct JsonBinder<T, std::enable_if_t<HasJsonFields<T>::value>>
+  {
+    static constexpr auto Fields = JsonFieldsOf(static_cast<const T*>(nullptr));
+    static constexpr std::size_t Count = std::tuple_size_v<decltype(Fields)>;
+
+    template <std::size_t... I>
+    static constexpr FieldTable<Count> MakeTable(std::index_sequence<I...>)
+    {
+      return FieldTable<Count>::Make({std::string_view(std::get<I>(Fields).name)...});
+    }
+    static constexpr FieldTable<Count> Table = MakeTable(std::make_index_sequence<Count>());
+
+    template <std::size_t I>
+    static void ReadField(StructReader& reader, T& value)
+    {
+      constexpr auto field = std::get<I>(Fields);
+      JsonBinder<typename decltype(field)::Type>::Read(reader, value.*field.member);
+    }
+
+    template <std::size_t... I>
+    static constexpr std::array<void (*)(StructReader&, T&), Count> MakeReaders(std::index_sequence<I...>)
+    {
+      return {&ReadField<I>...};
+    }
+    static constexpr std::array<void (*)(StructReader&, T&), Count> Readers =
+      MakeReaders(std::make_index_sequence<Count>());
+
+    static void Read(StructReader& reader, T& value)
+    {
+      reader.enter('{');
+      if (!reader.consume('}'))
+      {
+        do
+        {
+          std::size_t field = Table.find(reader.readString());
+          reader.expect(':');
+          if (field < Count)
+            Readers[field](reader, value);
+          else
+            reader.skipValue();
+        } while (reader.consume(','));
+        reader.expect('}');
+      }
+      reader.leave();
+    }
+
+    template <std::size_t... I>
+    static void WriteFields(std::ostream& output, const T& value, std::index_sequence<I...>)
+    {
+      // The names are identifiers, so they never need escaping.
+      ((output << (I == 0 ? "\"" : ",\"") << std::get<I>(Fields).name << "\":",
+        JsonBinder<typename std::tuple_element_t<I, std::remove_const_t<decltype(Fields)>>::Type>::Write(
+          output, value.*std::get<I>(Fields).member)),
+       ...);
+    }
+
+    static void Write(std::ostream& output, const T& value)
+    {
+      output << '{';
+      WriteFields(output, value, std::make_index_sequence<Count>());
+      output << '}';
+    }
+  };
+
+  /**
+   * @brief Parses json directly into C++ types and writes them back, without building nodes. Structs are registered
+   * with JSON_FIELDS, the parser for them is generated at compile time, see JsonBinder.
+   */
+  class StructBinding
+  {
+  public:
+    /**
+     * @brief Parses a json into a value. Throws an exception if the format is incorrect or does not match the type,
+     * the value may have been partly filled by then.
+     *
+     * @param text The text version of the json.
+     * @param value Receives the json.
+     * @param options Only maxDepth is used.
+     */
+    template <typename T>
+    static void Parse(std::string_view text, T& value, const ParseOptions& options = ParseOptions())
+    {
+      StructReader reader(text, options);
+      JsonBinder<T>::Read(reader, value);
+      reader.finish();
+    }
+
+    /**
+     * @brief Parses a json into a default constructed value, see Parse(text, value, options).
+     *
+     * @param text The text version of the json.
+     * @param options Only maxDepth is used.
+     * @return T
+     */
+    template <typename T>
+    static T Parse(std::string_view text, const ParseOptions& options = ParseOptions())
+    {
+      T value{};
+      Parse(text, value, options);
+      return value;
+    }
+
+    /**
+     * @brief Parses a json file straight from a memory mapping of it into a value. Throws an exception if the file
+     * cannot be read, the format is incorrect or does not match the type.
+     *
+     * @param path Path to the file.
+     * @param value Receives the json.
+     * @param options Only maxDepth is used.
+     */
+    template <typename T>
+    static void ParseFile(const std::string& path, T& value, const ParseOptions& options = ParseOptions())
+    {
+      MappedFile file(path);
+      Parse(file.getText(), value, options);
+    }
+
+    /**
+     * @brief Writes a value as compact json to the stream.
+     *
+     * @param value Value to write.
+     * @param output Output stream.
+     */
+    template <typename T>
+    static std::ostream& Write(const T& value, std::ostream& output)
+    {
+      JsonBinder<T>::Write(output, value);
+      return output;
+    }
+
+    /**
+     * @brief Returns a value as compact json.
+     *
+     * @param value Value to write.
+     * @return std::string
+     */
+    template <typename T>
+    static std::string Write(const T& value)
+    {
+      std::ostringstream output;
+      JsonBinder<T>::Write(output, value);
+      return output.str();
+    }
+  };
+
+} // namespace json
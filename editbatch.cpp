@@ -0,0 +1,42 @@
+#include "editbatch.h"
+#include "utils.h"
+
+#include <stdexcept>
+
+namespace json
+{
+  EditBatch::EditBatch(bool fullParse) : m_FullParse(fullParse)
+  {
+  }
+
+  void EditBatch::edit(const std::string& path, const std::string& json)
+  {
+    m_Changes.push_back(Change{Kind::Edit, SplitPath(path), {}, {}, json});
+  }
+
+  void EditBatch::create(const std::string& path, const std::string& key, const std::string& json)
+  {
+    m_Changes.push_back(Change{Kind::Create, SplitPath(path), {}, key, json});
+  }
+
+  void EditBatch::remove(const std::string& path)
+  {
+    m_Changes.push_back(Change{Kind::Remove, SplitPath(path), {}, {}, {}});
+  }
+
+  void EditBatch::move(const std::string& from, const std::string& to)
+  {
+    if (to.rfind(from, 0) == 0) // if toPath starts with fromPath it will break the json
+      throw std::runtime_error("This action will break the json structure.");
+    m_Changes.push_back(Change{Kind::Move, SplitPath(from), SplitPath(to), {}, {}});
+  }
+
+  std::vector<std::string> EditBatch::SplitPath(const std::string& path)
+  {
+    std::vector<std::string> paths = Utils::SplitString(path, "/");
+    if (paths.size() == 0)
+      throw std::runtime_error("Invalid args.");
+    return paths;
+  }
+
+} // namespace json
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief Collects changes to a json so that Node::apply makes them together. The changes are checked against the
+   * json before any of them is made, so a batch is made either whole or not at all. Every change addresses the json as
+   * it is before the batch, which is why a change may not go into or replace a part of the json that another change of
+   * the same batch replaces.
+   */
+  class EditBatch
+  {
+  public:
+    enum class Kind
+    {
+      Edit,
+      Create,
+      Remove,
+      Move
+    };
+
+    struct Change
+    {
+      Kind kind;
+      std::vector<std::string> path; // the member for Edit and Remove, the object for Create and the source for Move
+      std::vector<std::string> to;   // the object the members are moved to
+      std::string key;               // the key of the created member
+      std::string json;              // the new value for Edit and Create
+    };
+
+    /**
+     * @brief Construct a new EditBatch object
+     *
+     * @param fullParse Set to false if you want the parser to try and fix the jsons if they cannot be normally parsed.
+     */
+    explicit EditBatch(bool fullParse = true);
+
+    /**
+     * @brief Sets the value of every member with the key at the path, see Node::edit.
+     *
+     * @param path A forward slash separated path.
+     * @param json The json to replace the current value with.
+     */
+    void edit(const std::string& path, const std::string& json);
+
+    /**
+     * @brief Adds a member, creating the objects on the path that do not exist, see Node::create. Members created in
+     * the same object are added in the order they were created in.
+     *
+     * @param path A forward slash separated path to the object.
+     * @param key The key of the new member.
+     * @param json The json value of the new member.
+     */
+    void create(const std::string& path, const std::string& key, const std::string& json);
+
+    /**
+     * @brief Removes every member with the key at the path, see Node::remove.
+     *
+     * @param path A forward slash separated path.
+     */
+    void remove(const std::string& path);
+
+    /**
+     * @brief Moves the members of an object to the end of another, see Node::move.
+     *
+     * @param from A forward slash separated path.
+     * @param to A forward slash separated path.
+     */
+    void move(const std::string& from, const std::string& to);
+
+    const std::vector<Change>& getChanges() const
+    {
+      return m_Changes;
+    }
+
+    bool getFullParse() const
+    {
+      return m_FullParse;
+    }
+
+    std::size_t size() const
+    {
+      return m_Changes.size();
+    }
+
+    void clear()
+    {
+      m_Changes.clear();
+    }
+
+  private:
+    static std::vector<std::string> SplitPath(const std::string& path);
+
+  private:
+    std::vector<Change> m_Changes;
+    bool m_FullParse;
+  };
+
+} // namespace json
@@ -0,0 +1,331 @@
+#include "eventparser.h"
+#include "numberparser.h"
+#include "stringscanner.h"
+
+#include <iostream>
+#include <memory>
+
+namespace json
+{
+
+  /**
+   * @brief Token positions are reused by the parsers of a thread so that their pages are only faulted in once. Buffers
+   * of huge documents are not kept around.
+   */
+  struct CachedIndex
+  {
+    StructuralIndex index;
+    bool inUse = false; // a parser of the thread is running, parsers started by its handler need their own
+  };
+
+  static CachedIndex& ThreadIndex()
+  {
+    thread_local CachedIndex cached;
+    return cached;
+  }
+
+  static constexpr std::size_t MaxCachedTokens = 16 * 1024 * 1024;
+
+  /**
+   * @brief Returns the cached index of the thread if no other parser uses it, otherwise a new one owned by the parser.
+   */
+  static StructuralIndex& AcquireIndex(std::unique_ptr<StructuralIndex>& own)
+  {
+    CachedIndex& cached = ThreadIndex();
+    if (!cached.inUse)
+    {
+      cached.inUse = true;
+      return cached.index;
+    }
+    own = std::make_unique<StructuralIndex>();
+    return *own;
+  }
+
+  EventParser::EventParser(std::string_view text, JsonHandler& handler, bool shouldThrow, const ParseOptions& options)
+    : m_Handler(handler), m_ShouldThrow(shouldThrow), m_Options(options), m_Index(AcquireIndex(m_OwnIndex)),
+      m_Lexer(text)
+  {
+    // Error recovery of partial parsing may resume inside strings, which the token positions can not describe.
+    try
+    {
+      if (m_ShouldThrow && m_Index.build(text))
+        m_Lexer.setTokens(m_Index.getPositions(), m_Index.getSize());
+    }
+    catch (const std::exception& ex)
+    {
+      if (!m_OwnIndex) // the destructor does not run
+        ThreadIndex().inUse = false;
+      throw;
+    }
+  }
+
+  EventParser::~EventParser()
+  {
+    if (m_OwnIndex)
+      return;
+    m_Index.shrink(MaxCachedTokens);
+    ThreadIndex().inUse = false;
+  }
+
+  void EventParser::parse()
+  {
+    m_Containers.clear();
+    parseElement();
+    if (m_Lexer.peek() != -1)
+      error("EOF", m_Lexer.peekStr(1));
+  }
+
+  void EventParser::parseElements()
+  {
+    m_Containers.clear();
+    m_Handler.onStartArray();
+    m_Containers.push_back(Container{false, false, false, 0});
+    parseContainers(0);
+  }
+
+  void EventParser::parseElement()
+  {
+    std::size_t depth = m_Containers.size();
+    m_Lexer.skipWhitespace();
+    parseValue();
+    parseContainers(depth);
+    m_Lexer.skipWhitespace();
+  }
+
+  void EventParser::parseValue()
+  {
+    char next = m_Lexer.peek();
+    if (next == '{')
+      return openContainer(true);
+    else if (next == '[')
+      return openContainer(false);
+    else if (next == '"' || next == '\'')
+      return parseString(false);
+    if (Lexer::IsNumber(next))
+    {
+      return parseNumber();
+    }
+
+    std::string peek = m_Lexer.peekStr(5);
+    if (peek.rfind("false", 0) == 0)
+    {
+      m_Lexer.skipChars(5);
+      return m_Handler.onBool(false);
+    }
+
+    if (peek.rfind("true", 0) == 0)
+    {
+      m_Lexer.skipChars(4);
+      return m_Handler.onBool(true);
+    }
+
+    if (peek.rfind("null", 0) == 0)
+    {
+      m_Lexer.skipChars(4);
+      return m_Handler.onNull();
+    }
+
+    error("object/array/string/true/false/number/null", m_Lexer.peekStr(5));
+    m_Handler.onStartObject();
+    m_Handler.onEndObject(0);
+  }
+
+  void EventParser::openContainer(bool isObject)
+  {
+    if (m_Containers.size() >= m_Options.maxDepth)
+      throw std::runtime_error(errorMessage("at most " + std::to_string(m_Options.maxDepth) + " nested values",
+                                            m_Lexer.peekStr(1)));
+    m_Lexer.skipChar(); // { or [
+    if (isObject)
+      m_Handler.onStartObject();
+    else
+      m_Handler.onStartArray();
+    m_Containers.push_back(Container{isObject, true, false, 0});
+  }
+
+  void EventParser::parseContainers(std::size_t depth)
+  {
+    while (m_Containers.size() > depth)
+    {
+      Container& container = m_Containers.back();
+      if (container.inElement)
+      {
+        // The value of the last element or member is complete.
+        container.inElement = false;
+        container.count++;
+        m_Lexer.skipWhitespace();
+        if (m_Lexer.peek() == ',')
+          m_Lexer.skipChar();
+      }
+
+      m_Lexer.skipWhitespace();
+      char close = container.isObject ? '}' : ']';
+      if (m_Lexer.peek() == -1 || m_Lexer.peek() == close)
+      {
+        closeContainer();
+        continue;
+      }
+
+      if (container.isObject)
+      {
+        parseString(true);
+        m_Lexer.skipWhitespace();
+        if (m_Lexer.peek() != ':')
+        {
+          error(":", m_Lexer.peekStr(1));
+          while (m_Lexer.peek() != -1 && m_Lexer.peek() != ':')
+            m_Lexer.skipChar();
+        }
+        m_Lexer.skipChar();
+      }
+      container.inElement = true;
+      m_Lexer.skipWhitespace();
+      parseValue(); // invalidates container if it opens another one
+    }
+  }
+
+  void EventParser::closeContainer()
+  {
+    Container container = m_Containers.back();
+    m_Containers.pop_back();
+    if (!container.bracketed)
+    {
+      if (m_Lexer.peek() != -1)
+        error("EOF", m_Lexer.peekStr(1));
+      return m_Handler.onEndArray(container.count);
+    }
+
+    char close = container.isObject ? '}' : ']';
+    if (m_Lexer.peek() != close)
+    {
+      error(std::string(1, close), m_Lexer.peekStr(1));
+      while (m_Lexer.peek() != -1 && m_Lexer.peek() != close)
+        m_Lexer.skipChar();
+    }
+    m_Lexer.skipChar();
+    if (container.isObject)
+      m_Handler.onEndObject(container.count);
+    else
+      m_Handler.onEndArray(container.count);
+  }
+
+  void EventParser::parseString(bool isKey)
+  {
+    char expectedClose;
+    if (m_Lexer.peek() != '"' && m_Lexer.peek() != '\'')
+      error("\"", m_Lexer.peekStr(1));
+    expectedClose = m_Lexer.peek(); // ' or "
+    int64_t indexedLength = m_Lexer.indexedStringLength();
+    m_Lexer.skipChar();
+
+    // Only backslashes and control characters interrupt the search for the closing quote. When the structural index
+    // already knows where the string ends only those need to be looked for.
+    const char* start = m_Lexer.c_str();
+    const char* end = indexedLength >= 0 ? start + indexedLength : m_Lexer.end();
+    const char* pos = start;
+    bool escaped = false;
+    while (true)
+    {
+      pos += StringScanner::FindSpecial(pos, end, m_Lexer.end(), expectedClose);
+      if (pos == end || *pos == expectedClose)
+        break;
+      if (*pos == '\\')
+      {
+        escaped = true;
+        pos += end - pos > 1 ? 2 : 1;
+        continue;
+      }
+      moveTo(pos);
+      error("string character", "control character " + std::to_string((int)*pos));
+      pos++;
+    }
+
+    std::string_view result(start, pos - start);
+    if (escaped)
+      result = decodeString(start, pos, expectedClose);
+    moveTo(pos);
+    if (m_Lexer.peek() != expectedClose)
+    {
+      error(std::string(1, expectedClose), m_Lexer.peekStr(1));
+      while (m_Lexer.peek() != -1 && m_Lexer.peek() != '}')
+        m_Lexer.skipChar();
+    }
+    m_Lexer.skipChar();
+    if (isKey)
+      m_Handler.onKey(result);
+    else
+      m_Handler.onString(result);
+  }
+
+  std::string_view EventParser::decodeString(const char* begin, const char* end, char quote)
+  {
+    m_Scratch.resize(end - begin); // escapes never decode to more bytes than they take
+    char* result = &m_Scratch[0];
+    char* out = result;
+    const char* in = begin;
+    while (in < end)
+    {
+      const char* backslash = (const char*)std::memchr(in, '\\', end - in);
+      const char* runEnd = backslash ? backslash : end;
+      std::memcpy(out, in, runEnd - in);
+      out += runEnd - in;
+      in = runEnd;
+      if (in == end)
+        break;
+      if (!StringScanner::DecodeEscape(in, end, out, quote))
+      {
+        moveTo(in);
+        error("escape sequence", std::string(in, std::min<std::size_t>(end - in, 2)));
+        *out++ = *in++;
+      }
+    }
+    return std::string_view(result, out - result);
+  }
+
+  void EventParser::moveTo(const char* position)
+  {
+    if (position > m_Lexer.c_str())
+      m_Lexer.skipChars(position - m_Lexer.c_str());
+  }
+
+  void EventParser::parseNumber()
+  {
+    NumberParser::Result number =
+      NumberParser::Parse(m_Lexer.c_str(), m_Lexer.end(), m_Options.keepLargeIntegersUnsigned);
+    moveTo(number.end);
+    if (number.expected == nullptr && (Lexer::IsAlphaNum(m_Lexer.peek()) || m_Lexer.peek() == '.'))
+      number.expected = "number";
+    if (number.expected != nullptr)
+    {
+      error(number.expected, m_Lexer.peekStr(1));
+      while (Lexer::IsAlphaNum(m_Lexer.peek()) || m_Lexer.peek() == '.' || m_Lexer.peek() == '+' ||
+             m_Lexer.peek() == '-')
+        m_Lexer.skipChar();
+    }
+
+    switch (number.kind)
+    {
+    case NumberParser::Kind::Integer:
+      return m_Handler.onInt64(number.integer);
+    case NumberParser::Kind::Unsigned:
+      return m_Handler.onUnsigned(number.unsignedInteger);
+    case NumberParser::Kind::Double:
+      return m_Handler.onDouble(number.dbl);
+    }
+  }
+
+  std::string EventParser::errorMessage(const std::string& expected, const std::string& got)
+  {
+    return "Unexpected character at " + std::to_string(m_Lexer.getLine()) + ":" + std::to_string(m_Lexer.getColumn()) +
+           ". Expected \"" + expected + "\" got " + (got.empty() ? "blank" : got) + ".\n";
+  }
+
+  void EventParser::error(const std::string& expected, const std::string& got)
+  {
+    std::string res = errorMessage(expected, got);
+    if (m_ShouldThrow)
+      throw std::runtime_error(res);
+    std::cout << res;
+  }
+
+} // namespace json
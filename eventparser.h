@@ -0,0 +1,147 @@
+#pragma once
+
+#include "handler.h"
+#include "json.h"
+#include "lexer.h"
+#include "structural.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief Parses a json and reports its values to a JsonHandler as they are found. This is the grammar every other
+   * parser of the library is built on.
+   */
+  class EventParser
+  {
+  public:
+    /**
+     * @brief Construct a new EventParser object
+     *
+     * @param text The json text.
+     * @param handler Receives the values of the json.
+     * @param shouldThrow Set to false if you want to parse the json partially and want the parser to try and fix
+     * unparsable json-s. The events stay balanced while doing so.
+     * @param options Options controlling how the json is parsed.
+     */
+    EventParser(std::string_view text, JsonHandler& handler, bool shouldThrow = true,
+                const ParseOptions& options = ParseOptions());
+    ~EventParser();
+
+    /**
+     * @brief Parses the json, reporting exactly one value to the handler.
+     */
+    void parse();
+
+    /**
+     * @brief Parses the elements of an array without its brackets, as found between the brackets of a bigger array,
+     * reporting them to the handler as one array.
+     */
+    void parseElements();
+
+  private:
+    /**
+     * @brief An array or object whose members are being parsed.
+     */
+    struct Container
+    {
+      bool isObject;
+      bool bracketed;      // false for the elements passed to parseElements(), which have no brackets of their own
+      bool inElement;      // the value of an element or member has been started and not counted yet
+      std::size_t count;   // elements or members so far
+    };
+
+    /**
+     * @brief Parses an element, nested arrays and objects included. The open containers are kept on m_Containers
+     * instead of the call stack, so the nesting depth is only limited by ParseOptions::maxDepth.
+     * Refer to https://www.json.org/json-en.html
+     */
+    void parseElement();
+
+    /**
+     * @brief Parses a value. Arrays and objects are only opened, their contents are parsed by parseContainers().
+     * Refer to https://www.json.org/json-en.html
+     */
+    void parseValue();
+
+    /**
+     * @brief Opens an array or object at the current position. Throws if it would nest deeper than
+     * ParseOptions::maxDepth, even when parsing partially.
+     *
+     * @param isObject Open an object instead of an array.
+     */
+    void openContainer(bool isObject);
+
+    /**
+     * @brief Parses the members and elements of the open containers until only depth of them are left open.
+     * Refer to https://www.json.org/json-en.html
+     *
+     * @param depth Number of containers that stay open.
+     */
+    void parseContainers(std::size_t depth);
+
+    /**
+     * @brief Parses the closing bracket of the innermost container and reports its end.
+     */
+    void closeContainer();
+
+    /**
+     * @brief Parses a string.
+     * Refer to https://www.json.org/json-en.html
+     *
+     * @param isKey Report the string as the key of a member.
+     */
+    void parseString(bool isKey);
+
+    /**
+     * @brief Parses a number in place, see NumberParser::Parse.
+     * Refer to https://www.json.org/json-en.html
+     */
+    void parseNumber();
+
+    /**
+     * @brief Decodes the escape sequences of a string into the scratch buffer.
+     *
+     * @param begin First character after the opening quote.
+     * @param end The closing quote.
+     * @param quote The quote the string was opened with.
+     * @return std::string_view
+     */
+    std::string_view decodeString(const char* begin, const char* end, char quote);
+
+    /**
+     * @brief Advances the lexer to a position found by scanning ahead of it. Never moves backwards.
+     *
+     * @param position A pointer into the text.
+     */
+    void moveTo(const char* position);
+
+    /**
+     * @brief Called whenever an error during parsing occurs. Throws an exeption if m_ShouldThrow is set.
+     *
+     * @param expected What the parser actually exepcted.
+     * @param got What the parser received.
+     */
+    void error(const std::string& expected, const std::string& got);
+
+    /**
+     * @brief Formats the message of an error at the current position.
+     */
+    std::string errorMessage(const std::string& expected, const std::string& got);
+
+  private:
+    JsonHandler& m_Handler;
+    bool m_ShouldThrow;
+    ParseOptions m_Options;
+    std::unique_ptr<StructuralIndex> m_OwnIndex; // only when the cached index of the thread is in use
+    StructuralIndex& m_Index;
+    Lexer m_Lexer;
+    std::string m_Scratch; // decoded strings
+    std::vector<Container> m_Containers; // open arrays and objects, innermost last
+  };
+
+} // namespace json
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace json
+{
+  /**
+   * @brief Receives the values of a json in document order while it is being parsed, without a tree being built.
+   * Every callback does nothing by default, so a handler only overrides the ones it is interested in.
+   *
+   * Strings and keys are only valid until the callback returns. Strings without escape sequences point into the parsed
+   * text, decoded ones into a buffer of the parser.
+   */
+  class JsonHandler
+  {
+  public:
+    virtual ~JsonHandler() = default;
+
+    virtual void onStartObject()
+    {
+    }
+
+    /**
+     * @brief Called with the key of every member, before the events of its value.
+     */
+    virtual void onKey(std::string_view /*key*/)
+    {
+    }
+
+    /**
+     * @brief Called once every member of the object has been reported.
+     *
+     * @param memberCount Number of members of the object.
+     */
+    virtual void onEndObject(std::size_t /*memberCount*/)
+    {
+    }
+
+    virtual void onStartArray()
+    {
+    }
+
+    /**
+     * @brief Called once every element of the array has been reported.
+     *
+     * @param elementCount Number of elements of the array.
+     */
+    virtual void onEndArray(std::size_t /*elementCount*/)
+    {
+    }
+
+    virtual void onString(std::string_view /*str*/)
+    {
+    }
+
+    virtual void onInt64(int64_t /*value*/)
+    {
+    }
+
+    /**
+     * @brief Called for integers above INT64_MAX when ParseOptions::keepLargeIntegersUnsigned is set.
+     */
+    virtual void onUnsigned(uint64_t /*value*/)
+    {
+    }
+
+    virtual void onDouble(double /*value*/)
+    {
+    }
+
+    virtual void onBool(bool /*value*/)
+    {
+    }
+
+    virtual void onNull()
+    {
+    }
+  };
+
+} // namespace json
@@ -84,6 +84,7 @@ void Interpreter::processClose(const std::string& line, const std::vector<std::s
   }
   json::JsonParser::JsonFree(m_Json);
   m_Json = nullptr;
+  m_Index.reset();
   m_Filepath.clear();
   m_Saved = false;
   std::cout << "File closed." << std::endl;
@@ -92,6 +93,7 @@ void Interpreter::processClose(const std::string& line, const std::vector<std::s
 void Interpreter::processNew(const std::string& line, const std::vector<std::string>& args)
 {
   m_Json = json::JsonParser::Parse("{}");
+  m_Index.reset();
   m_Saved = false;
   m_Filepath = "";
   std::cout << "Empty document created." << std::endl;
@@ -112,16 +114,10 @@ void Interpreter::processOpen(const std::string& line, const std::vector<std::st
   }
   else
     resultArg = args[1];
-  std::ifstream input(resultArg);
-  if (input.is_open())
-  {
-    std::string str((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
-    m_Json = m_FullParse ? json::JsonParser::Parse(str) : json::JsonParser::ParsePartially(str);
-    m_Filepath = resultArg;
-    json::JsonParser::PrettyPrint(m_Json);
-  }
-  else
-    throw std::runtime_error("Document not found.");
+  m_Json = m_FullParse ? json::JsonParser::ParseFile(resultArg) : json::JsonParser::ParseFilePartially(resultArg);
+  m_Index.reset();
+  m_Filepath = resultArg;
+  json::JsonParser::PrettyPrint(m_Json);
   m_Saved = true;
 }
 
@@ -133,9 +129,7 @@ void Interpreter::processSearch(const std::string& line, const std::vector<std::
   if (!m_Json)
     throw std::runtime_error("No document open.");
 
-  json::Json array = m_Json->search(args[1]);
-  json::JsonParser::PrettyPrint(array);
-  json::JsonParser::JsonFree(array);
+  json::JsonParser::PrettyPrint(search(args[1]), std::cout);
 }
 
 void Interpreter::processRemove(const std::string& line, const std::vector<std::string>& args)
@@ -148,7 +142,7 @@ void Interpreter::processRemove(const std::string& line, const std::vector<std::
 
   try
   {
-    m_Json->remove(path);
+    m_Json->remove(path, m_Index.get());
     std::cout << "Element " << path << " removed." << std::endl;
   }
   catch (const std::exception& ex)
@@ -165,7 +159,7 @@ void Interpreter::processMove(const std::string& line, const std::vector<std::st
   if (!m_Json)
     throw std::runtime_error("No document open.");
 
-  m_Json->move(args[1], args[2]);
+  m_Json->move(args[1], args[2], m_Index.get());
   std::cout << "Element " << args[1] << " moved." << std::endl;
   m_Saved = false;
 }
@@ -180,7 +174,7 @@ void Interpreter::processEdit(const std::string& line, const std::vector<std::st
   std::string json =
     line.substr(args[0].size() + 1 + args[1].size() + 1, line.size() - args[0].size() - 1 - args[1].size() - 1);
 
-  m_Json->edit(path, json, m_FullParse);
+  m_Json->edit(path, json, m_FullParse, m_Index.get());
   std::cout << "Value editted." << std::endl;
   m_Saved = false;
 }
@@ -195,7 +189,7 @@ void Interpreter::processCreate(const std::string& line, const std::vector<std::
   std::string json = line.substr(args[0].size() + 1 + args[1].size() + 1 + args[2].size() + 1,
                                  line.size() - args[0].size() - 1 - args[1].size() - 1 - args[2].size());
 
-  m_Json->create(path, key, json, m_FullParse);
+  m_Json->create(path, key, json, m_FullParse, m_Index.get());
   std::cout << "Member created." << std::endl;
   m_Saved = false;
 }
@@ -228,14 +222,13 @@ void Interpreter::processSaveSearch(const std::string& line, const std::vector<s
   std::ofstream output(args[2]);
   if (output.is_open())
   {
-    json::Json array = m_Json->search(args[1]);
-    if (array->getSize() == 0)
+    const std::vector<json::MemberRef>& members = search(args[1]);
+    if (members.empty())
       throw std::runtime_error("Key not found");
-    else if (array->getSize() == 1)
-      json::JsonParser::PrettyPrint(array->data.array.values[0], output);
+    else if (members.size() == 1)
+      json::JsonParser::PrettyPrint(members[0], output);
     else
-      json::JsonParser::PrettyPrint(array, output);
-    json::JsonParser::JsonFree(array);
+      json::JsonParser::PrettyPrint(members, output);
     output.close();
     std::cout << "Search result saved to " << args[2] << "." << std::endl;
   }
@@ -283,14 +276,13 @@ void Interpreter::processSaveSearchCompact(const std::string& line, const std::v
   std::ofstream output(args[2]);
   if (output.is_open())
   {
-    json::Json array = m_Json->search(args[1]);
-    if (array->getSize() == 0)
+    const std::vector<json::MemberRef>& members = search(args[1]);
+    if (members.empty())
       throw std::runtime_error("Key not found");
-    else if (array->getSize() == 1)
-      json::JsonParser::CompactPrint(array->data.array.values[0], output);
+    else if (members.size() == 1)
+      json::JsonParser::CompactPrint(members[0], output);
     else
-      json::JsonParser::CompactPrint(array, output);
-    json::JsonParser::JsonFree(array);
+      json::JsonParser::CompactPrint(members, output);
     std::cout << "Search result saved to " << args[2] << "." << std::endl;
     output.close();
   }
@@ -298,6 +290,13 @@ void Interpreter::processSaveSearchCompact(const std::string& line, const std::v
     throw std::runtime_error("Invalid path.");
 }
 
+const std::vector<json::MemberRef>& Interpreter::search(const std::string& key)
+{
+  if (!m_Index)
+    m_Index.reset(new json::KeyIndex(*m_Json));
+  return m_Index->find(key);
+}
+
 void Interpreter::processExit()
 {
   if (m_Json)
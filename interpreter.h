@@ -1,7 +1,9 @@
 #pragma once
 
 #include "json.h"
+#include "keyindex.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -108,9 +110,16 @@ private:
    */
   void processExit();
 
+  /**
+   * @brief Searches the open document for a key. The document is indexed by the first search and the index is kept up to
+   * date by the commands changing the document, so repeated searches do not walk the document.
+   */
+  const std::vector<json::MemberRef>& search(const std::string& key);
+
 private:
   bool m_FullParse = true;
   bool m_Saved = false;
   json::Json m_Json = nullptr;
+  std::unique_ptr<json::KeyIndex> m_Index; // built by the first search
   std::string m_Filepath;
 };
\ No newline at end of file
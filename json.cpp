@@ -1,93 +1,518 @@
 #include "json.h"
+#include "arena.h"
+#include "editbatch.h"
+#include "eventparser.h"
+#include "keyindex.h"
+#include "keytable.h"
+#include "mappedfile.h"
+#include "parallelparser.h"
 #include "parser.h"
+#include "pointer.h"
+#include "stringscanner.h"
+#include "threadpool.h"
 #include "utils.h"
+#include "validator.h"
 
+#include <algorithm>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <utility>
 
 namespace json
 {
 
-  Json JsonParser::Parse(const std::string& text)
+  /**
+   * @brief Parses a json into a new arena which becomes owned by the returned root.
+   */
+  static Json ParseDocument(std::string_view text, bool shouldThrow, const ParseOptions& options,
+                            unsigned threadCount = 1)
   {
-    return Parser(text).parseJson();
+    Arena* arena = new Arena();
+    try
+    {
+      Node* root = threadCount == 1 ? Parser(text, *arena, shouldThrow, options).parseJson()
+                                    : ParallelParser(text, *arena, threadCount, options).parseJson();
+      arena->setRoot(root);
+      return root;
+    }
+    catch (...)
+    {
+      delete arena;
+      throw;
+    }
   }
 
-  Json JsonParser::ParsePartially(const std::string& text)
+  /**
+   * @brief Returns the arena the node is stored in or nullptr if the node was allocated on the heap.
+   */
+  static Arena* ArenaOf(const Node* node)
   {
-    return Parser(text, false).parseJson();
+    return (node->flags & Node::InArena) ? Arena::Of(node) : nullptr;
   }
 
-  void JsonParser::PrettyPrint(Json json)
+  /**
+   * @brief Starts a new generation of the document of a node before it is changed, so that the nodes cached by pointers
+   * into it are looked up again.
+   */
+  static void Touch(const Node* node)
   {
-    PrettyPrint(json, std::cout);
+    if (Arena* arena = ArenaOf(node))
+      arena->touch();
   }
 
-  std::ostream& JsonParser::PrettyPrint(Json json, std::ostream& output)
+  static Node* NewNode(Arena* arena, NodeType type)
   {
-    PrettyPrintUtil(output, json);
-    output << std::endl;
-    return output;
+    Node* node = arena ? arena->create<Node>() : new Node();
+    node->type = type;
+    node->flags = arena ? Node::InArena : 0;
+    return node;
   }
 
-  std::ostream& JsonParser::PrettyPrintUtil(std::ostream& output, Json json, uint32_t indent)
+  static Node* NewString(Arena* arena, std::string_view str)
   {
-    switch (json->type)
+    Node* node = NewNode(arena, NodeType::String);
+    if (node->setInline(str))
+      return node;
+    char* copy = arena ? arena->copyString(str) : new char[str.size() + 1];
+    if (!arena)
     {
-    case NodeType::Object:
-      if (json->data.object.length == 0)
+      std::memcpy(copy, str.data(), str.size());
+      copy[str.size()] = '\0';
+    }
+    node->data.string.length = str.size();
+    node->data.string.ptr = copy;
+    return node;
+  }
+
+  /**
+   * @brief Returns the node of a key. Keys of a document in an arena are interned in its key table.
+   */
+  static Node* NewKey(Arena* arena, std::string_view key)
+  {
+    return arena ? arena->getKeys().intern(key, false) : NewString(nullptr, key);
+  }
+
+  static JsonMember* NewMember(Arena* arena, Node* name, Node* value)
+  {
+    if (!arena)
+      return new JsonMember(name, value);
+    JsonMember* member = arena->create<JsonMember>();
+    member->nameNode = name;
+    member->node = value;
+    return member;
+  }
+
+  static void FreeMembers(Arena* arena, JsonMember** members)
+  {
+    if (!arena)
+      delete[] members;
+  }
+
+  /**
+   * @brief Returns how many members or elements the values of an array or object have room for.
+   */
+  static std::size_t CapacityOf(const Node& node)
+  {
+    return node.capacityLog2 ? (std::size_t)1 << node.capacityLog2 : node.data.array.length; // same layout for objects
+  }
+
+  template <typename T>
+  static T* Reallocate(Arena* arena, T* values, std::size_t length, std::size_t capacity)
+  {
+    T* grown = arena ? arena->allocateArray<T>(capacity) : new T[capacity];
+    if (length > 0)
+      std::memcpy(grown, values, length * sizeof(T));
+    if (!arena)
+      delete[] values;
+    return grown;
+  }
+
+  /**
+   * @brief Makes room in an array or object for count more members or elements. The room is a power of two that is at
+   * least doubled whenever it runs out, so adding n of them one at a time moves O(n) pointers.
+   */
+  static void Grow(Arena* arena, Node& node, std::size_t count)
+  {
+    std::size_t length = node.data.array.length; // same layout for objects
+    if (length + count <= CapacityOf(node))
+      return;
+    uint8_t log2 = 2;
+    while (((std::size_t)1 << log2) < length + count)
+      log2++;
+    node.capacityLog2 = log2;
+    if (node.type == NodeType::Array)
+      node.data.array.values = Reallocate(arena, node.data.array.values, length, (std::size_t)1 << log2);
+    else
+      node.data.object.values = Reallocate(arena, node.data.object.values, length, (std::size_t)1 << log2);
+  }
+
+  /**
+   * @brief Open addressing hash table from the keys of an object to the position of the first member with that key.
+   * Positions are stored one based so that 0 marks an empty slot. At most half of the slots are used.
+   */
+  struct MemberIndex
+  {
+    std::size_t mask; // number of slots - 1
+    std::size_t used; // distinct keys
+    bool duplicates;  // some key belongs to more than one member
+    uint32_t* slots;
+  };
+
+  static MemberIndex* NewIndex(Arena* arena, std::size_t slotCount)
+  {
+    MemberIndex* index = arena ? arena->create<MemberIndex>() : new MemberIndex();
+    index->mask = slotCount - 1;
+    index->used = 0;
+    index->duplicates = false;
+    index->slots = arena ? arena->allocateArray<uint32_t>(slotCount) : new uint32_t[slotCount];
+    std::memset(index->slots, 0, slotCount * sizeof(uint32_t));
+    return index;
+  }
+
+  static void FreeIndex(Arena* arena, MemberIndex* index)
+  {
+    if (arena || !index)
+      return;
+    delete[] index->slots;
+    delete index;
+  }
+
+  static bool IsContainer(const Node& node)
+  {
+    return node.type == NodeType::Array || node.type == NodeType::Object;
+  }
+
+  static std::string_view KeyAt(const Node& object, std::size_t position)
+  {
+    return object.data.object.values[position]->nameNode->getString();
+  }
+
+  /**
+   * @brief Adds the member at the position to the index of the object, unless a member before it has the same key.
+   */
+  static void IndexMember(const Node& object, std::size_t position)
+  {
+    MemberIndex& index = *object.data.object.index;
+    std::string_view key = KeyAt(object, position);
+    for (std::size_t slot = std::hash<std::string_view>()(key) & index.mask;; slot = (slot + 1) & index.mask)
+    {
+      uint32_t entry = index.slots[slot];
+      if (entry == 0)
       {
-        output << "{ }";
-        return output;
+        index.slots[slot] = (uint32_t)(position + 1);
+        index.used++;
+        return;
       }
-      output << "{";
-      output << std::endl;
-      for (uint32_t i = 0; i < json->data.object.length; i++)
+      if (KeyAt(object, entry - 1) == key)
       {
-        for (uint32_t i = 0; i < indent; i++)
-          output << " ";
-
-        output << "\"" << json->data.object.values[i]->nameNode->data.string.ptr << "\": ";
-        PrettyPrintUtil(output, json->data.object.values[i]->node, indent + 2);
-        if (i != json->data.array.length - 1)
-          output << ",";
-        output << std::endl;
+        index.duplicates = true;
+        return;
       }
-      for (uint32_t i = 0; i < indent - 2; i++)
-        output << " ";
-      output << "}";
-      break;
-    case NodeType::Array:
-      output << "[ ";
-      for (uint32_t i = 0; i < json->data.array.length; i++)
+    }
+  }
+
+  /**
+   * @brief Looks a key up in the key table of the document of the node. Returns false if no member of the document has
+   * the key. Otherwise interned is set to the node all members with the key share, or to nullptr for nodes on the heap
+   * whose keys are not interned and have to be compared by their characters.
+   */
+  static bool FindKey(const Node& node, std::string_view key, const Node*& interned)
+  {
+    interned = nullptr;
+    const KeyTable* keys = (node.flags & Node::InArena) ? Arena::Of(&node)->findKeys() : nullptr;
+    if (keys == nullptr)
+      return true;
+    interned = keys->find(key);
+    return interned != nullptr;
+  }
+
+  static bool HasKey(const JsonMember& member, std::string_view key, const Node* interned)
+  {
+    return interned ? member.nameNode == interned : member.nameNode->getString() == key;
+  }
+
+  /**
+   * @brief Returns the position of the first member with the key, or the length of the object if there is none.
+   */
+  static std::size_t FindMember(const Node& object, std::string_view key)
+  {
+    const Node* interned;
+    if (!FindKey(object, key, interned))
+      return object.data.object.length;
+    const MemberIndex* index = object.data.object.index;
+    if (index == nullptr)
+    {
+      for (std::size_t i = 0; i < object.data.object.length; ++i)
+        if (HasKey(*object.data.object.values[i], key, interned))
+          return i;
+      return object.data.object.length;
+    }
+    for (std::size_t slot = std::hash<std::string_view>()(key) & index->mask;; slot = (slot + 1) & index->mask)
+    {
+      uint32_t entry = index->slots[slot];
+      if (entry == 0)
+        return object.data.object.length;
+      if (HasKey(*object.data.object.values[entry - 1], key, interned))
+        return entry - 1;
+    }
+  }
+
+  /**
+   * @brief Keeps the index up to date after a member was appended to the object.
+   */
+  static void IndexAppended(Node& object)
+  {
+    MemberIndex* index = object.data.object.index;
+    if (index != nullptr && 2 * (index->used + 1) <= index->mask + 1)
+      IndexMember(object, object.data.object.length - 1);
+    else
+      object.updateIndex();
+  }
+
+  /**
+   * @brief Follows the first keys of a pointer from a node. Throws the errors of operator[] if they do not lead to a
+   * node.
+   */
+  template <typename T>
+  static T& Follow(T& root, const JsonPointer& pointer, std::size_t count)
+  {
+    T* node = &root;
+    for (std::size_t i = 0; i < count; i++)
+    {
+      if (node->type == NodeType::Array)
       {
-        PrettyPrintUtil(output, json->data.array.values[i], indent);
-        if (i != json->data.array.length - 1)
-          output << ", ";
+        std::size_t index = pointer.getIndex(i);
+        if (index >= node->data.array.length)
+          throw std::runtime_error("Invalid element index.");
+        node = node->data.array.values[index];
+        continue;
       }
-      output << " ]";
-      break;
+      if (node->type != NodeType::Object)
+        throw std::runtime_error("Node is not an object.");
+      std::size_t position = FindMember(*node, pointer.getKey(i));
+      if (position == node->data.object.length)
+        throw std::runtime_error("Invalid member index (" + pointer.getKey(i) + ").");
+      node = node->data.object.values[position]->node;
+    }
+    return *node;
+  }
+
+  /**
+   * @brief Adds a member to the end of an object.
+   */
+  static void AppendMember(Arena* arena, Node& object, Node* key, Node* value)
+  {
+    Grow(arena, object, 1);
+    object.data.object.values[object.data.object.length++] = NewMember(arena, key, value);
+    IndexAppended(object);
+  }
+
+  /**
+   * @brief Parses a json so that it can be attached to a node allocated in the given arena.
+   */
+  static Node* ParseInto(Arena* arena, std::string_view text, bool fullParse)
+  {
+    if (arena)
+      return Parser(text, *arena, fullParse).parseJson();
+    Node* parsed = fullParse ? JsonParser::Parse(text) : JsonParser::ParsePartially(text);
+    Node* copy = new Node(*parsed);
+    JsonParser::JsonFree(parsed);
+    return copy;
+  }
+
+  Json JsonParser::Parse(std::string_view text, const ParseOptions& options)
+  {
+    return ParseDocument(text, true, options);
+  }
+
+  Json JsonParser::ParsePartially(std::string_view text, const ParseOptions& options)
+  {
+    return ParseDocument(text, false, options);
+  }
+
+  Json JsonParser::ParseFile(const std::string& path, const ParseOptions& options)
+  {
+    MappedFile file(path);
+    ParseOptions fileOptions = options;
+    fileOptions.borrowStrings = false;
+    return ParseDocument(file.getText(), true, fileOptions);
+  }
+
+  Json JsonParser::ParseFilePartially(const std::string& path, const ParseOptions& options)
+  {
+    MappedFile file(path);
+    ParseOptions fileOptions = options;
+    fileOptions.borrowStrings = false;
+    return ParseDocument(file.getText(), false, fileOptions);
+  }
+
+  Json JsonParser::ParseParallel(std::string_view text, unsigned threadCount, const ParseOptions& options)
+  {
+    return ParseDocument(text, true, options, threadCount);
+  }
+
+  Json JsonParser::ParseFileParallel(const std::string& path, unsigned threadCount, const ParseOptions& options)
+  {
+    MappedFile file(path);
+    ParseOptions fileOptions = options;
+    fileOptions.borrowStrings = false;
+    return ParseDocument(file.getText(), true, fileOptions, threadCount);
+  }
+
+  ValidationResult JsonParser::Validate(std::string_view text)
+  {
+    return Validator(text).validate();
+  }
+
+  ValidationResult JsonParser::ValidateFile(const std::string& path)
+  {
+    MappedFile file(path);
+    return Validator(file.getText()).validate();
+  }
+
+  void JsonParser::Parse(std::string_view text, JsonHandler& handler, const ParseOptions& options)
+  {
+    EventParser(text, handler, true, options).parse();
+  }
+
+  void JsonParser::ParseFile(const std::string& path, JsonHandler& handler, const ParseOptions& options)
+  {
+    MappedFile file(path);
+    EventParser(file.getText(), handler, true, options).parse();
+  }
+
+  static std::ostream& PrintInteger(std::ostream& output, const Node& node)
+  {
+    if (node.flags & Node::UnsignedInteger)
+      return output << (uint64_t)node.data.integer;
+    return output << node.data.integer;
+  }
+
+  static std::ostream& PrintString(std::ostream& output, const Node& node)
+  {
+    return StringScanner::WriteQuoted(output, node.getString());
+  }
+
+  void JsonParser::PrettyPrint(Json json)
+  {
+    PrettyPrint(json, std::cout);
+  }
+
+  std::ostream& JsonParser::PrettyPrint(Json json, std::ostream& output)
+  {
+    PrettyPrintUtil(output, json);
+    output << std::endl;
+    return output;
+  }
+
+  static std::ostream& PrintScalar(std::ostream& output, const Node& node)
+  {
+    switch (node.type)
+    {
     case NodeType::Integer:
-      output << json->data.integer;
+      PrintInteger(output, node);
       break;
     case NodeType::Double:
-      output << json->data.dbl;
+      output << node.data.dbl;
       break;
     case NodeType::Null:
-      break;
       output << "null";
+      break;
     case NodeType::Boolean:
-      output << (json->data.boolean == true ? "true" : "false");
+      output << (node.data.boolean == true ? "true" : "false");
       break;
     case NodeType::String:
-      output << "\"" << json->data.string.ptr << "\"";
-      break;
-    case NodeType::None:
+      PrintString(output, node);
       break;
     }
     return output;
   }
 
+  /**
+   * @brief Writes a json without recursing, the arrays and objects being written are kept on an explicit stack.
+   *
+   * @param output Output stream.
+   * @param json Json to print.
+   * @param pretty Put every member on a line of its own, otherwise no whitespace is written.
+   * @param indent Left indentation of the members of the outermost object.
+   */
+  static std::ostream& Print(std::ostream& output, const Node* json, bool pretty, uint32_t indent)
+  {
+    struct Frame
+    {
+      const Node* node;
+      std::size_t next; // index of the next member or element to write
+      uint32_t indent;
+    };
+    std::vector<Frame> stack;
+
+    const Node* value = json;
+    while (true)
+    {
+      if (value->type == NodeType::Object)
+      {
+        output << (pretty && value->data.object.length == 0 ? "{ " : "{");
+        stack.push_back(Frame{value, 0, indent});
+      }
+      else if (value->type == NodeType::Array)
+      {
+        output << (pretty ? "[ " : "[");
+        stack.push_back(Frame{value, 0, indent});
+      }
+      else
+        PrintScalar(output, *value);
+
+      value = nullptr;
+      while (value == nullptr && !stack.empty())
+      {
+        Frame& frame = stack.back();
+        const Node& node = *frame.node;
+        bool isObject = node.type == NodeType::Object;
+        if (frame.next == node.data.array.length) // same layout for objects
+        {
+          if (pretty && isObject && node.data.object.length > 0)
+          {
+            output << '\n';
+            for (uint32_t i = 0; i + 2 < frame.indent; i++)
+              output << " ";
+          }
+          output << (!isObject ? (pretty ? " ]" : "]") : "}");
+          stack.pop_back();
+          continue;
+        }
+
+        std::size_t i = frame.next++;
+        if (i > 0)
+          output << (pretty && !isObject ? ", " : ",");
+        if (isObject)
+        {
+          if (pretty)
+          {
+            output << '\n';
+            for (uint32_t j = 0; j < frame.indent; j++)
+              output << " ";
+          }
+          PrintString(output, *node.data.object.values[i]->nameNode) << (pretty ? ": " : ":");
+          value = node.data.object.values[i]->node;
+          indent = frame.indent + 2;
+        }
+        else
+        {
+          value = node.data.array.values[i];
+          indent = frame.indent;
+        }
+      }
+      if (value == nullptr)
+        return output;
+    }
+  }
+
+  std::ostream& JsonParser::PrettyPrintUtil(std::ostream& output, Json json, uint32_t indent)
+  {
+    return Print(output, json, true, indent);
+  }
+
   void JsonParser::CompactPrint(Json json)
   {
     CompactPrint(json, std::cout);
@@ -95,157 +520,473 @@ namespace json
 
   std::ostream& JsonParser::CompactPrint(Json json, std::ostream& output)
   {
-    switch (json->type)
+    return Print(output, json, false, 0);
+  }
+
+  /**
+   * @brief Writes a member as an object holding only that member, the way Print writes such an object.
+   */
+  static std::ostream& PrintMember(std::ostream& output, const MemberRef& member, bool pretty, uint32_t indent)
+  {
+    output << "{";
+    if (pretty)
     {
-    case NodeType::Object:
-      output << "{";
-      for (uint32_t i = 0; i < json->data.object.length; i++)
-      {
-        output << "\"" << json->data.object.values[i]->nameNode->data.string.ptr << "\":";
-        CompactPrint(json->data.object.values[i]->node, output);
-        if (i != json->data.array.length - 1)
-          output << ",";
-      }
-      output << "}";
-      break;
-    case NodeType::Array:
-      output << "[";
-      for (uint32_t i = 0; i < json->data.array.length; i++)
-      {
-        CompactPrint(json->data.array.values[i], output);
-        if (i != json->data.array.length - 1)
-          output << ",";
-      }
-      output << "]";
-      break;
-    case NodeType::Integer:
-      output << json->data.integer;
-      break;
-    case NodeType::Double:
-      output << json->data.dbl;
-      break;
-    case NodeType::Null:
-      break;
-      output << "null";
-    case NodeType::Boolean:
-      output << (json->data.boolean == true ? "true" : "false");
-      break;
-    case NodeType::String:
-      output << "\"" << json->data.string.ptr << "\"";
-      break;
-    case NodeType::None:
-      break;
+      output << '\n';
+      for (uint32_t i = 0; i < indent; i++)
+        output << " ";
+    }
+    PrintString(output, member.getKey()) << (pretty ? ": " : ":");
+    Print(output, &member.getValue(), pretty, indent + 2);
+    if (pretty)
+    {
+      output << '\n';
+      for (uint32_t i = 0; i + 2 < indent; i++)
+        output << " ";
     }
+    return output << "}";
+  }
+
+  /**
+   * @brief Writes members as an array of objects holding one member each, the way Print writes such an array.
+   */
+  static std::ostream& PrintMembers(std::ostream& output, const std::vector<MemberRef>& members, bool pretty,
+                                    uint32_t indent)
+  {
+    output << (pretty ? "[ " : "[");
+    for (std::size_t i = 0; i < members.size(); i++)
+    {
+      if (i > 0)
+        output << (pretty ? ", " : ",");
+      PrintMember(output, members[i], pretty, indent);
+    }
+    return output << (pretty ? " ]" : "]");
+  }
+
+  std::ostream& JsonParser::PrettyPrint(const MemberRef& member, std::ostream& output)
+  {
+    PrintMember(output, member, true, 2);
+    output << std::endl;
+    return output;
+  }
+
+  std::ostream& JsonParser::PrettyPrint(const std::vector<MemberRef>& members, std::ostream& output)
+  {
+    PrintMembers(output, members, true, 2);
+    output << std::endl;
     return output;
   }
 
+  std::ostream& JsonParser::CompactPrint(const MemberRef& member, std::ostream& output)
+  {
+    return PrintMember(output, member, false, 0);
+  }
+
+  std::ostream& JsonParser::CompactPrint(const std::vector<MemberRef>& members, std::ostream& output)
+  {
+    return PrintMembers(output, members, false, 0);
+  }
+
   void JsonParser::JsonFree(Json json)
   {
+    if (json == nullptr)
+      return;
+    if (json->flags & Node::InArena)
+    {
+      Arena* arena = Arena::Of(json);
+      if (arena->getRoot() == json)
+        delete arena;
+      return;
+    }
     delete json;
   }
 
-  void Node::searchUtil(const char* key, const Node& node, std::vector<Node*>& output)
+  void Node::searchUtil(std::string_view key, const Node* interned, const Node& node, std::size_t begin,
+                        std::size_t end, std::vector<MemberRef>& output)
   {
-    if (node.type == NodeType::Array)
-      for (std::size_t i = 0; i < node.getSize(); i++)
-        searchUtil(key, node[i], output);
-    if (node.type == NodeType::Object)
-      for (std::size_t i = 0; i < node.getSize(); i++)
+    // Depth first in document order, with the containers being walked on an explicit stack.
+    std::vector<std::pair<const Node*, std::size_t>> stack;
+    stack.emplace_back(&node, begin);
+    while (!stack.empty())
+    {
+      const Node& current = *stack.back().first;
+      std::size_t i = stack.back().second++;
+      if (i == (stack.size() == 1 ? end : current.data.array.length)) // same layout for objects
       {
-        if (!std::strcmp(node.data.object.values[i]->nameNode->data.string.ptr, key))
-        {
-          Node* obj = new Node();
-          obj->type = NodeType::Object;
-          obj->data.object.length = 1;
-          obj->data.object.values = new JsonMember*[1];
-          obj->data.object.values[0] = new JsonMember(new Node(*node.data.object.values[i]->nameNode),
-                                                      new Node(*node.data.object.values[i]->node));
-          output.push_back(obj);
-        }
-        searchUtil(key, *node.data.object.values[i]->node, output);
+        stack.pop_back();
+        continue;
       }
-  }
 
-  Node::Node()
-  {
-    std::memset(this, 0, sizeof(Node));
+      const Node* child;
+      if (current.type == NodeType::Object)
+      {
+        const JsonMember& member = *current.data.object.values[i];
+        if (HasKey(member, key, interned))
+          output.push_back(MemberRef{&current, i});
+        child = member.node;
+      }
+      else
+        child = current.data.array.values[i];
+      if (IsContainer(*child))
+        stack.emplace_back(child, 0);
+    }
   }
 
-  Node::~Node()
+  /**
+   * @brief Moves the children of a heap allocated array or object to pending and frees the arrays and members that held
+   * them, so that deleting the node does not recurse.
+   */
+  static void DetachChildren(Node& node, std::vector<Node*>& pending)
   {
-    switch (type)
+    if (node.type == NodeType::Array)
     {
-    case (NodeType::Array):
-      for (uint32_t i = 0; i < data.array.length; i++)
-        delete data.array.values[i];
-      delete[] data.array.values;
-      data.array.values = nullptr;
-      break;
-    case (NodeType::Object):
-      for (uint32_t i = 0; i < data.object.length; i++)
-        delete data.object.values[i];
-      delete[] data.object.values;
-      data.object.values = nullptr;
-      break;
-    case (NodeType::String):
-      delete[] data.string.ptr;
-      data.string.ptr = nullptr;
-      break;
+      pending.insert(pending.end(), node.data.array.values, node.data.array.values + node.data.array.length);
+      delete[] node.data.array.values;
     }
-    type = NodeType::None;
+    else if (node.type == NodeType::Object)
+    {
+      for (std::size_t i = 0; i < node.data.object.length; i++)
+      {
+        JsonMember* member = node.data.object.values[i];
+        pending.push_back(member->nameNode);
+        pending.push_back(member->node);
+        member->nameNode = nullptr;
+        member->node = nullptr;
+        delete member;
+      }
+      delete[] node.data.object.values;
+      FreeIndex(nullptr, node.data.object.index);
+    }
+    else
+      return;
+    node.type = NodeType::None;
   }
 
-  Node::Node(const Node& other)
+  /**
+   * @brief Copies the type and value of a node. Arrays and objects get new children that are still empty, they are
+   * returned in pending together with the nodes they have to be copied from.
+   */
+  static void CopyShallow(Node& copy, const Node& other, std::vector<std::pair<Node*, const Node*>>& pending)
   {
-    type = other.type;
+    copy.type = other.type;
+    copy.capacityLog2 = 0;
+    copy.flags = 0;
     switch (other.type)
     {
     case (NodeType::Array):
-      data.array.length = other.data.array.length;
-      data.array.values = new Node*[data.array.length];
-      std::memcpy(data.array.values, other.data.array.values, data.array.length * sizeof(Node*));
+      copy.data.array.length = other.data.array.length;
+      copy.data.array.values = new Node*[copy.data.array.length];
+      for (std::size_t i = 0; i < copy.data.array.length; i++)
+      {
+        copy.data.array.values[i] = new Node();
+        pending.emplace_back(copy.data.array.values[i], other.data.array.values[i]);
+      }
       break;
     case (NodeType::Object):
-      data.object.length = other.data.object.length;
-      data.object.values = new JsonMember*[data.object.length];
-      for (uint32_t i = 0; i < data.object.length; i++)
-        data.object.values[i] = new JsonMember(new Node(*other.data.object.values[i]->nameNode),
-                                               new Node(*other.data.object.values[i]->node));
-
+      copy.data.object.length = other.data.object.length;
+      copy.data.object.values = new JsonMember*[copy.data.object.length];
+      for (std::size_t i = 0; i < copy.data.object.length; i++)
+      {
+        JsonMember* member = new JsonMember(new Node(*other.data.object.values[i]->nameNode), new Node());
+        copy.data.object.values[i] = member;
+        pending.emplace_back(member->node, other.data.object.values[i]->node);
+      }
+      copy.data.object.index = nullptr;
+      copy.updateIndex();
       break;
     case (NodeType::Double):
-      data.dbl = other.data.dbl;
+      copy.data.dbl = other.data.dbl;
       break;
     case (NodeType::Integer):
-      data.integer = other.data.integer;
+      copy.data.integer = other.data.integer;
+      copy.flags = other.flags & Node::UnsignedInteger;
       break;
     case (NodeType::Boolean):
-      data.boolean = other.data.boolean;
+      copy.data.boolean = other.data.boolean;
       break;
     case (NodeType::String):
-      data.string.length = other.data.string.length;
-      char* copy = new char[data.string.length + 1];
-      std::memcpy(copy, other.data.string.ptr, data.string.length + 1); // +1 for \0
-      data.string.ptr = copy;
+      std::string_view chars = other.getString();
+      if (copy.setInline(chars))
+        break;
+      copy.data.string.length = chars.size();
+      char* str = new char[chars.size() + 1];
+      std::memcpy(str, chars.data(), chars.size());
+      str[chars.size()] = '\0'; // borrowed strings are not null terminated
+      copy.data.string.ptr = str;
       break;
     }
   }
 
+  Node::Node()
+  {
+    std::memset(this, 0, sizeof(Node));
+  }
+
+  Node::~Node()
+  {
+    if (flags & InArena) // released together with the arena
+      return;
+    if (type == NodeType::String)
+    {
+      if (!(flags & (BorrowedString | InlineString)))
+        delete[] data.string.ptr;
+      data.string.ptr = nullptr;
+    }
+    else if (type == NodeType::Array || type == NodeType::Object)
+    {
+      // Descendants are detached before being deleted, so deleting a deep tree does not recurse.
+      std::vector<Node*> pending;
+      DetachChildren(*this, pending);
+      while (!pending.empty())
+      {
+        Node* node = pending.back();
+        pending.pop_back();
+        DetachChildren(*node, pending);
+        delete node;
+      }
+    }
+    type = NodeType::None;
+  }
+
+  Node::Node(const Node& other)
+  {
+    std::vector<std::pair<Node*, const Node*>> pending;
+    CopyShallow(*this, other, pending);
+    while (!pending.empty())
+    {
+      std::pair<Node*, const Node*> next = pending.back();
+      pending.pop_back();
+      CopyShallow(*next.first, *next.second, pending);
+    }
+  }
+
+  void Node::updateIndex()
+  {
+    if (type != NodeType::Object)
+      return;
+    Arena* arena = ArenaOf(this);
+    FreeIndex(arena, data.object.index);
+    data.object.index = nullptr;
+    if (data.object.length < IndexedObjectSize || data.object.length >= UINT32_MAX)
+      return;
+
+    std::size_t slotCount = 2 * IndexedObjectSize;
+    while (slotCount < 2 * data.object.length)
+      slotCount *= 2;
+    data.object.index = NewIndex(arena, slotCount);
+    for (std::size_t i = 0; i < data.object.length; i++)
+      IndexMember(*this, i);
+  }
+
   Json Node::search(const std::string& key) const
   {
+    std::vector<MemberRef> members = find(key);
     Node* array = new Node();
     array->type = NodeType::Array;
-    std::vector<Node*> output;
-    searchUtil(key.c_str(), *this, output);
+    array->data.array.length = members.size();
+    array->data.array.values = new Node*[members.size()];
+    for (std::size_t i = 0; i < members.size(); i++)
+    {
+      Node* obj = new Node();
+      obj->type = NodeType::Object;
+      obj->data.object.length = 1;
+      obj->data.object.values = new JsonMember*[1];
+      obj->data.object.values[0] = new JsonMember(new Node(members[i].getKey()), new Node(members[i].getValue()));
+      array->data.array.values[i] = obj;
+    }
+    return array;
+  }
 
-    array->data.array.length = output.size();
-    array->data.array.values = new Node*[output.size()];
+  std::vector<MemberRef> Node::find(std::string_view key) const
+  {
+    std::vector<MemberRef> output;
+    const Node* interned;
+    if (IsContainer(*this) && FindKey(*this, key, interned))
+      searchUtil(key, interned, *this, 0, data.array.length, output);
+    return output;
+  }
 
-    std::memcpy(array->data.array.values, output.data(), output.size() * sizeof(Node*));
-    return array;
+  /**
+   * @brief A part of a parallel search, the members or elements [begin, end) of a node and everything in them. Hits
+   * found while splitting the json are kept in output ahead of the range.
+   */
+  struct SearchRange
+  {
+    const Node* node;
+    std::size_t begin;
+    std::size_t end;
+    std::vector<MemberRef> output;
+  };
+
+  std::vector<MemberRef> Node::findParallel(std::string_view key, unsigned threadCount) const
+  {
+    const Node* interned;
+    if (!IsContainer(*this) || !FindKey(*this, key, interned))
+      return std::vector<MemberRef>();
+    if (threadCount == 0)
+      threadCount = ThreadPool::DefaultThreadCount();
+    if (threadCount == 1)
+      return find(key);
+
+    // Cut the json into ranges in document order, several per thread so that threads finishing early take more. A range
+    // of many children is cut into runs of them, a range of one child is replaced by the range of its value.
+    std::size_t target = (std::size_t)threadCount * 8;
+    std::vector<SearchRange> ranges;
+    ranges.push_back(SearchRange{this, 0, data.array.length, {}});
+    bool split = true;
+    while (split && ranges.size() < target)
+    {
+      split = false;
+      std::vector<SearchRange> next;
+      std::size_t parts = target / ranges.size() + 1;
+      for (SearchRange& range : ranges)
+      {
+        std::size_t count = range.end - range.begin;
+        if (count > 1)
+        {
+          std::size_t runs = std::min(count, parts);
+          for (std::size_t i = 0; i < runs; i++)
+            next.push_back(SearchRange{range.node, range.begin + count * i / runs, range.begin + count * (i + 1) / runs,
+                                       i == 0 ? std::move(range.output) : std::vector<MemberRef>()});
+          split = true;
+        }
+        else if (count == 1)
+        {
+          const Node* child;
+          if (range.node->type == NodeType::Object)
+          {
+            const JsonMember& member = *range.node->data.object.values[range.begin];
+            if (HasKey(member, key, interned))
+              range.output.push_back(MemberRef{range.node, range.begin});
+            child = member.node;
+          }
+          else
+            child = range.node->data.array.values[range.begin];
+          if (IsContainer(*child))
+            next.push_back(SearchRange{child, 0, child->data.array.length, std::move(range.output)});
+          else
+            next.push_back(SearchRange{range.node, range.begin, range.begin, std::move(range.output)});
+          split = true;
+        }
+        else
+          next.push_back(std::move(range));
+      }
+      ranges.swap(next);
+    }
+
+    {
+      ThreadPool pool((unsigned)std::min<std::size_t>(threadCount, ranges.size()));
+      std::vector<std::future<void>> results;
+      for (SearchRange& range : ranges)
+      {
+        if (range.begin < range.end)
+          results.push_back(pool.submit([&range, key, interned]() {
+            searchUtil(key, interned, *range.node, range.begin, range.end, range.output);
+          }));
+      }
+      for (std::future<void>& result : results)
+        result.get();
+    }
+
+    std::size_t total = 0;
+    for (const SearchRange& range : ranges)
+      total += range.output.size();
+    std::vector<MemberRef> output;
+    output.reserve(total);
+    for (const SearchRange& range : ranges)
+      output.insert(output.end(), range.output.begin(), range.output.end());
+    return output;
+  }
+
+  /**
+   * @brief Sets the value of every member of an object with the key to a parsed json. Without repeated keys the index
+   * of the object finds the only one.
+   */
+  static void ReplaceMembers(Arena* arena, Node& object, std::string_view key, Node* value, std::string_view text,
+                             bool fullParse, KeyIndex* index)
+  {
+    std::size_t first = FindMember(object, key);
+    std::size_t last = object.data.object.index && !object.data.object.index->duplicates ? first + 1
+                                                                                           : object.data.object.length;
+    bool replaced = false;
+    for (std::size_t i = first; i < last; i++)
+    {
+      if (KeyAt(object, i) == key)
+      {
+        if (index)
+          index->removeMember(object, i);
+        if (!arena)
+          delete object.data.object.values[i]->node;
+        // Repeated keys get values of their own, a node shared by two members would be freed or changed twice.
+        object.data.object.values[i]->node = replaced ? ParseInto(arena, text, fullParse) : value;
+        replaced = true;
+        if (index)
+          index->addMember(object, i);
+      }
+    }
+  }
+
+  /**
+   * @brief Removes the members of an object whose key matches, moving the rest to the front in one pass.
+   */
+  template <typename Matches>
+  static void RemoveMembers(Node& object, Matches matches, KeyIndex* index)
+  {
+    bool heap = ArenaOf(&object) == nullptr;
+    if (index)
+    {
+      for (std::size_t i = 0; i < object.data.object.length; i++)
+      {
+        if (matches(KeyAt(object, i)))
+          index->removeMember(object, i);
+      }
+    }
+    std::size_t copyIdx = 0;
+    for (std::size_t i = 0; i < object.data.object.length; i++)
+    {
+      if (!matches(KeyAt(object, i)))
+      {
+        object.data.object.values[copyIdx] = object.data.object.values[i];
+        if (index && copyIdx != i)
+          index->moveMember(object, i, copyIdx);
+        copyIdx++;
+      }
+      else if (heap)
+        delete object.data.object.values[i];
+    }
+    object.data.object.length = copyIdx;
+    object.updateIndex();
+  }
+
+  /**
+   * @brief Moves the members of an object to the end of another.
+   */
+  static void MoveMembers(Arena* arena, Node& from, Node& to, KeyIndex* index)
+  {
+    if (index)
+    {
+      for (std::size_t i = 0; i < from.data.object.length; i++)
+        index->removeMember(from, i);
+    }
+    std::size_t length = to.data.object.length;
+    Grow(arena, to, from.data.object.length);
+    if (from.data.object.length > 0)
+      std::memcpy(to.data.object.values + to.data.object.length, from.data.object.values,
+                  from.data.object.length * sizeof(JsonMember*));
+    to.data.object.length = to.data.object.length + from.data.object.length;
+    FreeMembers(arena, from.data.object.values);
+    from.data.object.values = nullptr;
+    from.data.object.length = 0;
+    from.capacityLog2 = 0;
+    to.updateIndex();
+    from.updateIndex();
+    if (index)
+    {
+      for (std::size_t i = length; i < to.data.object.length; i++)
+        index->addMember(to, i);
+    }
   }
 
-  void Node::remove(const std::string& path)
+  void Node::remove(const std::string& path, KeyIndex* index)
   {
     auto paths = Utils::SplitString(path, "/");
     if (paths.size() == 0)
@@ -258,23 +999,12 @@ namespace json
       c = &(*c)[path];
     }
 
-    Node& prev = *p;
-    JsonMember** copy = new JsonMember*[prev.data.object.length - 1];
-    uint32_t copyIdx = 0;
-    for (std::size_t i = 0; i < prev.data.object.length; i++)
-    {
-      if (std::strcmp(prev.data.object.values[i]->nameNode->data.string.ptr,
-                      paths[paths.size() - 1].c_str())) // do not match
-        copy[copyIdx++] = prev.data.object.values[i];
-      else
-        delete prev.data.object.values[i];
-    }
-    delete[] prev.data.object.values;
-    prev.data.object.length = copyIdx;
-    prev.data.object.values = copy;
+    std::string_view key = paths[paths.size() - 1];
+    Touch(this);
+    RemoveMembers(*p, [key](std::string_view name) { return name == key; }, index);
   }
 
-  void Node::move(const std::string& from, const std::string& to)
+  void Node::move(const std::string& from, const std::string& to, KeyIndex* index)
   {
     auto fromPaths = Utils::SplitString(from, "/");
     auto toPaths = Utils::SplitString(to, "/");
@@ -304,17 +1034,8 @@ namespace json
       if (pFrom->type != NodeType::Object || c->type != NodeType::Object)
         throw std::runtime_error("Can only move from object to object.");
 
-      JsonMember** copy = new JsonMember*[c->data.object.length + pFrom->data.object.length];
-      std::memcpy(copy, c->data.object.values, c->data.object.length * sizeof(JsonMember*));
-      std::memcpy(copy + c->data.object.length, pFrom->data.object.values,
-                  pFrom->data.object.length * sizeof(JsonMember*));
-
-      delete[] c->data.object.values;
-      c->data.object.values = copy;
-      c->data.object.length = c->data.object.length + pFrom->data.object.length;
-      delete[] pFrom->data.object.values;
-      pFrom->data.object.values = nullptr;
-      pFrom->data.object.length = 0;
+      Touch(this);
+      MoveMembers(ArenaOf(this), *pFrom, *c, index);
     }
     catch (const std::exception& ex)
     {
@@ -322,104 +1043,447 @@ namespace json
     }
   }
 
-  void Node::edit(const std::string& path, const std::string& text, bool fullParse)
+  static constexpr std::size_t NoChange = SIZE_MAX;
+
+  /**
+   * @brief A path that changes of a batch go through. Paths shared by several changes are looked up once.
+   */
+  struct BatchStep
   {
-    Node* parsedJson = nullptr;
-    parsedJson = fullParse ? JsonParser::Parse(text) : JsonParser::ParsePartially(text);
-    try
+    Node* node;         // what the path leads to, nullptr until a change creates it
+    std::size_t parent; // step of the object holding it
+    std::string_view key;
+    std::size_t replacedBy = NoChange;        // change replacing the value
+    std::size_t membersReplacedBy = NoChange; // change moving the members away
+    std::size_t appends = 0;                  // members the batch adds to the object
+    bool counted = false;                     // a created object counted as an append of its parent
+    bool reserved = false;                    // room was made for the appends
+  };
+
+  /**
+   * @brief A path of a change of a batch, the path of the change followed by key if there is one.
+   */
+  struct BatchPath
+  {
+    const std::vector<std::string>* path;
+    const std::string* key;
+    std::size_t* step; // receives the step the path leads to
+
+    std::size_t size() const
     {
-      auto paths = Utils::SplitString(path, "/");
-      if (paths.size() == 0)
-        throw std::runtime_error("Invalid args.");
-      Node* current = this;
-      Node* prev = this;
-      for (auto& path : paths)
+      return path->size() + (key ? 1 : 0);
+    }
+
+    const std::string& operator[](std::size_t i) const
+    {
+      return i < path->size() ? (*path)[i] : *key;
+    }
+  };
+
+  /**
+   * @brief Gives every path of a batch its step, grouping the paths by the keys they share so that each member is
+   * looked up once. Consecutive changes usually share the first keys, so each path starts from the steps of the
+   * previous one. The other steps are found in an open addressing table of the steps by their parent and key.
+   */
+  static void FindSteps(std::vector<BatchStep>& steps, const std::vector<BatchPath>& paths)
+  {
+    std::size_t keyCount = 0;
+    for (const BatchPath& path : paths)
+      keyCount += path.size();
+    std::size_t slotCount = 16;
+    while (slotCount < 2 * keyCount)
+      slotCount *= 2;
+    std::vector<std::size_t> slots(slotCount, 0); // steps + 1, 0 for empty slots
+    std::size_t mask = slotCount - 1;
+
+    std::vector<std::size_t> stack{0}; // steps of the previous path, the root first
+    const BatchPath* previous = nullptr;
+    for (const BatchPath& path : paths)
+    {
+      std::size_t common = 0;
+      while (previous && common < previous->size() && common < path.size() && (*previous)[common] == path[common])
+        common++;
+      stack.resize(common + 1);
+      for (std::size_t i = common; i < path.size(); i++)
       {
-        prev = current;
-        current = &(*current)[path];
+        std::string_view key = path[i];
+        std::size_t parent = stack.back();
+        std::size_t slot = (std::hash<std::string_view>()(key) ^ parent * 0x9e3779b97f4a7c15ull) & mask;
+        while (slots[slot] != 0 && (steps[slots[slot] - 1].parent != parent || steps[slots[slot] - 1].key != key))
+          slot = (slot + 1) & mask;
+        if (slots[slot] == 0)
+        {
+          Node* node = nullptr;
+          const Node* object = steps[parent].node;
+          if (object != nullptr && object->type == NodeType::Object)
+          {
+            std::size_t position = FindMember(*object, key);
+            if (position < object->data.object.length)
+              node = object->data.object.values[position]->node;
+          }
+          steps.push_back(BatchStep{node, parent, key});
+          slots[slot] = steps.size();
+        }
+        stack.push_back(slots[slot] - 1);
       }
-      for (std::size_t i = 0; i < prev->data.object.length; i++)
+      *path.step = stack.back();
+      previous = &path;
+    }
+  }
+
+  /**
+   * @brief Throws the error Node::operator[] would if the path of a step goes through a node that is not an object, or
+   * with mustExist if it does not lead to a member of the json.
+   */
+  static void CheckPath(const std::vector<BatchStep>& steps, std::size_t step, bool mustExist)
+  {
+    std::vector<std::size_t> chain;
+    for (; step != 0; step = steps[step].parent)
+      chain.push_back(step);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+    {
+      const Node* object = steps[steps[*it].parent].node;
+      if (object != nullptr && object->type != NodeType::Object)
+        throw std::runtime_error("Node is not an object.");
+      if (mustExist && steps[*it].node == nullptr)
+        throw std::runtime_error("Invalid member index (" + std::string(steps[*it].key) + ").");
+    }
+  }
+
+  static std::string StepPath(const std::vector<BatchStep>& steps, std::size_t step)
+  {
+    std::string path;
+    for (; step != 0; step = steps[step].parent)
+      path.insert(0, "/" + std::string(steps[step].key));
+    return path.empty() ? "/" : path.substr(1);
+  }
+
+  /**
+   * @brief Throws if a change goes into or replaces a part of the json that another change replaces.
+   */
+  static void CheckConflicts(const std::vector<BatchStep>& steps, std::size_t target, std::size_t change)
+  {
+    for (std::size_t step = target;; step = steps[step].parent)
+    {
+      std::size_t replacedBy = steps[step].replacedBy;
+      std::size_t membersReplacedBy = step != target ? steps[step].membersReplacedBy : NoChange;
+      if ((replacedBy != NoChange && replacedBy != change) ||
+          (membersReplacedBy != NoChange && membersReplacedBy != change))
+        throw std::runtime_error("Conflicting changes to " + StepPath(steps, step) + ".");
+      if (step == 0)
+        return;
+    }
+  }
+
+  static void Claim(const std::vector<BatchStep>& steps, std::size_t step, std::size_t& owner, std::size_t change)
+  {
+    if (owner != NoChange)
+      throw std::runtime_error("Conflicting changes to " + StepPath(steps, step) + ".");
+    owner = change;
+  }
+
+  /**
+   * @brief Returns the object of a step, creating it and the objects above it that do not exist yet.
+   */
+  static Node& MakeObject(std::vector<BatchStep>& steps, std::size_t step, Arena* arena, KeyIndex* index);
+
+  /**
+   * @brief Makes room in the object of a step for every member the batch adds to it, the first time it is asked.
+   */
+  static Node& ReserveObject(std::vector<BatchStep>& steps, std::size_t step, Arena* arena, KeyIndex* index)
+  {
+    Node& object = MakeObject(steps, step, arena, index);
+    if (!steps[step].reserved)
+    {
+      Grow(arena, object, steps[step].appends);
+      steps[step].reserved = true;
+    }
+    return object;
+  }
+
+  static Node& MakeObject(std::vector<BatchStep>& steps, std::size_t step, Arena* arena, KeyIndex* index)
+  {
+    if (steps[step].node != nullptr)
+      return *steps[step].node;
+    Node& parent = ReserveObject(steps, steps[step].parent, arena, index);
+    Node* node = NewNode(arena, NodeType::Object);
+    AppendMember(arena, parent, NewKey(arena, steps[step].key), node);
+    if (index)
+      index->addMember(parent, parent.data.object.length - 1);
+    steps[step].node = node;
+    return *node;
+  }
+
+  void Node::apply(const EditBatch& batch, KeyIndex* index)
+  {
+    const std::vector<EditBatch::Change>& changes = batch.getChanges();
+    using Kind = EditBatch::Kind;
+
+    // Look every path up once and check each change against the json as it is.
+    std::vector<BatchStep> steps;
+    steps.push_back(BatchStep{this, 0, std::string_view()});
+    std::vector<std::size_t> targets(changes.size()), destinations(changes.size(), 0);
+    std::vector<BatchPath> paths;
+    for (std::size_t i = 0; i < changes.size(); i++)
+    {
+      const EditBatch::Change& change = changes[i];
+      paths.push_back(BatchPath{&change.path, change.kind == Kind::Create ? &change.key : nullptr, &targets[i]});
+      if (change.kind == Kind::Move)
+        paths.push_back(BatchPath{&change.to, nullptr, &destinations[i]});
+    }
+    FindSteps(steps, paths);
+
+    for (std::size_t i = 0; i < changes.size(); i++)
+    {
+      BatchStep& target = steps[targets[i]];
+      switch (changes[i].kind)
+      {
+      case Kind::Edit:
+      case Kind::Remove:
+        CheckPath(steps, targets[i], true);
+        Claim(steps, targets[i], target.replacedBy, i);
+        break;
+      case Kind::Create:
+        CheckPath(steps, target.parent, false);
+        if (steps[target.parent].node != nullptr && steps[target.parent].node->type != NodeType::Object)
+          throw std::runtime_error("Node is not an object.");
+        Claim(steps, targets[i], target.replacedBy, i);
+        break;
+      case Kind::Move:
+        CheckPath(steps, targets[i], true);
+        CheckPath(steps, destinations[i], true);
+        if (target.node->type != NodeType::Object || steps[destinations[i]].node->type != NodeType::Object)
+          throw std::runtime_error("Can only move from object to object.");
+        Claim(steps, targets[i], target.membersReplacedBy, i);
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < changes.size(); i++)
+    {
+      CheckConflicts(steps, targets[i], i);
+      if (changes[i].kind != Kind::Move)
+        continue;
+      CheckConflicts(steps, destinations[i], i);
+      if (steps[destinations[i]].membersReplacedBy != NoChange)
+        throw std::runtime_error("Conflicting changes to " + StepPath(steps, destinations[i]) + ".");
+    }
+
+    // Count what is added to each object, so that each gets room for all of it at once.
+    for (std::size_t i = 0; i < changes.size(); i++)
+    {
+      if (changes[i].kind == Kind::Create)
       {
-        if (!std::strcmp(prev->data.object.values[i]->nameNode->data.string.ptr, paths[paths.size() - 1].c_str()))
+        std::size_t object = steps[targets[i]].parent;
+        steps[object].appends++;
+        for (std::size_t step = object; steps[step].node == nullptr && !steps[step].counted; step = steps[step].parent)
         {
-          delete prev->data.object.values[i]->node;
-          prev->data.object.values[i]->node = parsedJson;
+          steps[step].counted = true;
+          steps[steps[step].parent].appends++;
         }
       }
+      else if (changes[i].kind == Kind::Move)
+        steps[destinations[i]].appends += steps[targets[i]].node->data.object.length;
+    }
+
+    Arena* arena = ArenaOf(this);
+    std::vector<Node*> values(changes.size(), nullptr);
+    try
+    {
+      for (std::size_t i = 0; i < changes.size(); i++)
+      {
+        if (changes[i].kind == Kind::Edit || changes[i].kind == Kind::Create)
+          values[i] = ParseInto(arena, changes[i].json, batch.getFullParse());
+      }
     }
     catch (const std::exception& ex)
     {
-      // JsonParser::JsonFree(parsedJson);
+      if (!arena)
+      {
+        for (Node* value : values)
+          delete value;
+      }
       throw;
     }
+
+    // Nothing can fail from here on.
+    Touch(this);
+    std::vector<std::pair<std::size_t, std::string_view>> removed; // objects and keys of the removed members
+    for (std::size_t i = 0; i < changes.size(); i++)
+    {
+      const BatchStep& step = steps[targets[i]];
+      if (changes[i].kind == Kind::Edit)
+        ReplaceMembers(arena, *steps[step.parent].node, step.key, values[i], changes[i].json, batch.getFullParse(),
+                       index);
+      else if (changes[i].kind == Kind::Remove)
+        removed.emplace_back(step.parent, step.key);
+    }
+    std::sort(removed.begin(), removed.end());
+    for (auto first = removed.begin(); first != removed.end();)
+    {
+      auto last =
+        std::find_if(first, removed.end(), [first](const auto& remove) { return remove.first != first->first; });
+      RemoveMembers(
+        *steps[first->first].node,
+        [first, last](std::string_view key) {
+          return std::binary_search(first, last, std::make_pair(first->first, key));
+        },
+        index);
+      first = last;
+    }
+    for (std::size_t i = 0; i < changes.size(); i++)
+    {
+      if (changes[i].kind == Kind::Create)
+      {
+        Node& object = ReserveObject(steps, steps[targets[i]].parent, arena, index);
+        AppendMember(arena, object, NewKey(arena, changes[i].key), values[i]);
+        if (index)
+          index->addMember(object, object.data.object.length - 1);
+      }
+      else if (changes[i].kind == Kind::Move)
+        MoveMembers(arena, *steps[targets[i]].node, ReserveObject(steps, destinations[i], arena, index), index);
+    }
   }
 
-  void Node::create(const std::string& path, const std::string& key, const std::string& text, bool fullParse)
+  void Node::edit(const std::string& path, const std::string& text, bool fullParse, KeyIndex* index)
   {
-    Node* parsedJson = nullptr;
-    parsedJson = fullParse ? JsonParser::Parse(text) : JsonParser::ParsePartially(text);
-    try
+    auto paths = Utils::SplitString(path, "/");
+    if (paths.size() == 0)
+      throw std::runtime_error("Invalid args.");
+    Node* current = this;
+    Node* prev = this;
+    for (auto& path : paths)
+    {
+      prev = current;
+      current = &(*current)[path];
+    }
+
+    Arena* arena = ArenaOf(this);
+    Node* parsedJson = ParseInto(arena, text, fullParse);
+    Touch(this);
+    ReplaceMembers(arena, *prev, paths[paths.size() - 1], parsedJson, text, fullParse, index);
+  }
+
+  void Node::edit(const JsonPointer& path, const std::string& text, bool fullParse, KeyIndex* index)
+  {
+    if (path.size() == 0)
+      throw std::runtime_error("Invalid args.");
+    Node& parent = Follow(*this, path, path.size() - 1);
+    const std::string& key = path.getKey(path.size() - 1);
+    std::size_t position = path.getIndex(path.size() - 1);
+    if (parent.type == NodeType::Array)
     {
-      auto paths = Utils::SplitString(path, "/");
-      if (paths.size() == 0)
-        throw std::runtime_error("Invalid args.");
-      Node* current = this;
-      for (auto& path : paths)
+      if (position >= parent.data.array.length)
+        throw std::runtime_error("Invalid element index.");
+    }
+    else if (parent.type != NodeType::Object)
+      throw std::runtime_error("Node is not an object.");
+    else if (FindMember(parent, key) == parent.data.object.length)
+      throw std::runtime_error("Invalid member index (" + key + ").");
+
+    Arena* arena = ArenaOf(this);
+    Node* parsedJson = ParseInto(arena, text, fullParse);
+    Touch(this);
+    if (parent.type == NodeType::Object)
+    {
+      ReplaceMembers(arena, parent, key, parsedJson, text, fullParse, index);
+      return;
+    }
+    if (index)
+      index->removeMember(parent, position);
+    if (!arena)
+      delete parent.data.array.values[position];
+    parent.data.array.values[position] = parsedJson;
+    if (index)
+      index->addMember(parent, position);
+  }
+
+  void Node::create(const std::string& path, const std::string& key, const std::string& text, bool fullParse,
+                    KeyIndex* index)
+  {
+    auto paths = Utils::SplitString(path, "/");
+    if (paths.size() == 0)
+      throw std::runtime_error("Invalid args.");
+
+    Arena* arena = ArenaOf(this);
+    Node* parsedJson = ParseInto(arena, text, fullParse);
+    Touch(this);
+    Node* current = this;
+    for (auto& path : paths)
+    {
+      try
       {
-        try
-        {
-          current = &(*current)[path];
-        }
-        catch (const std::exception& ex)
+        current = &(*current)[path];
+      }
+      catch (const std::exception& ex)
+      {
+        if (current->type != NodeType::Object)
         {
-          JsonMember** members = new JsonMember*[current->data.object.length + 1];
-          std::memcpy(members, current->data.object.values, current->data.object.length * sizeof(JsonMember*));
-          Node* node = new Node();
-          node->type = NodeType::Object;
-
-          node->data.object.values = nullptr;
-          node->data.object.length = 0;
-
-          Node* pathNode = new Node();
-          pathNode->type = NodeType::String;
-          pathNode->data.string.length = path.size();
-          char* copy = new char[path.size() + 1];
-          std::memcpy(copy, path.c_str(), path.size() + 1);
-          pathNode->data.string.ptr = copy;
-          members[current->data.object.length] = new JsonMember();
-          members[current->data.object.length]->nameNode = pathNode;
-          members[current->data.object.length]->node = node;
-          current->data.object.length += 1;
-          delete[] current->data.object.values;
-          current->data.object.values = members;
-          current = &(*current)[path];
+          if (!arena)
+            delete parsedJson;
+          throw;
         }
+        Node* node = NewNode(arena, NodeType::Object);
+        AppendMember(arena, *current, NewKey(arena, path), node);
+        if (index)
+          index->addMember(*current, current->data.object.length - 1);
+        current = node;
       }
+    }
+
+    if (current->type != NodeType::Object)
+    {
+      if (!arena)
+        delete parsedJson;
+      throw std::runtime_error("Node is not an object.");
+    }
+    AppendMember(arena, *current, NewKey(arena, key), parsedJson);
+    if (index)
+      index->addMember(*current, current->data.object.length - 1);
+  }
 
-      JsonMember** copy = new JsonMember*[current->data.object.length + 1];
-      std::memcpy(copy, current->data.object.values, current->data.object.length * sizeof(JsonMember*));
-      delete[] current->data.object.values;
-      current->data.object.values = copy;
+  void Node::append(const std::string& path, const std::string& text, bool fullParse, KeyIndex* index)
+  {
+    Node* array = this;
+    for (auto& key : Utils::SplitString(path, "/"))
+      array = &(*array)[key];
+    if (array->type != NodeType::Array)
+      throw std::runtime_error("Node is not an array.");
+    array->insert("", array->data.array.length, text, fullParse, index);
+  }
 
-      Node* nameNode = new Node();
-      nameNode->type = NodeType::String;
-      nameNode->data.string.length = key.size();
-      char* nameCopy = new char[key.size() + 1];
-      std::memcpy(nameCopy, key.c_str(), key.size() + 1);
-      nameNode->data.string.ptr = nameCopy;
+  void Node::insert(const std::string& path, std::size_t position, const std::string& text, bool fullParse,
+                    KeyIndex* index)
+  {
+    Node* array = this;
+    for (auto& key : Utils::SplitString(path, "/"))
+      array = &(*array)[key];
+    if (array->type != NodeType::Array)
+      throw std::runtime_error("Node is not an array.");
+    if (position > array->data.array.length)
+      throw std::runtime_error("Invalid element index.");
 
-      current->data.object.values[current->data.object.length] = new JsonMember();
-      current->data.object.values[current->data.object.length]->nameNode = nameNode;
-      current->data.object.values[current->data.object.length]->node = parsedJson;
-      current->data.object.length++;
-    }
-    catch (const std::exception& ex)
+    Arena* arena = ArenaOf(this);
+    Node* parsedJson = ParseInto(arena, text, fullParse);
+    Touch(this);
+    Grow(arena, *array, 1);
+    Node** values = array->data.array.values;
+    std::memmove(values + position + 1, values + position, (array->data.array.length - position) * sizeof(Node*));
+    values[position] = parsedJson;
+    array->data.array.length++;
+    if (index)
     {
-      // JsonParser::JsonFree(parsedJson);
-      throw;
+      for (std::size_t i = array->data.array.length - 1; i > position; i--)
+        index->moveMember(*array, i - 1, i);
+      index->addMember(*array, position);
     }
   }
 
+  void Node::reserve(std::size_t count)
+  {
+    if (type == NodeType::Array || type == NodeType::Object)
+      Grow(ArenaOf(this), *this, count);
+  }
+
   const Node& Node::operator[](std::size_t index) const
   {
     if (type != NodeType::Array || index < 0 || ((unsigned int)index) >= data.array.length)
@@ -435,9 +1499,9 @@ namespace json
     if (type != NodeType::Object)
       throw std::runtime_error("Node is not an object.");
 
-    for (std::size_t i = 0; i < data.object.length; ++i)
-      if (!strcmp(data.object.values[i]->nameNode->data.string.ptr, index.c_str()))
-        return *data.object.values[i]->node;
+    std::size_t position = FindMember(*this, index);
+    if (position < data.object.length)
+      return *data.object.values[position]->node;
 
     throw std::runtime_error(std::string("Invalid member index (") + index + ").");
   }
@@ -447,17 +1511,38 @@ namespace json
     if (type != NodeType::Object)
       throw std::runtime_error("Node is not an object.");
 
-    for (std::size_t i = 0; i < data.object.length; ++i)
-      if (!strcmp(data.object.values[i]->nameNode->data.string.ptr, index.c_str()))
-        return *data.object.values[i]->node;
+    std::size_t position = FindMember(*this, index);
+    if (position < data.object.length)
+      return *data.object.values[position]->node;
 
     throw std::runtime_error("Invalid index.");
   }
 
+  const Node& Node::at(const JsonPointer& pointer) const
+  {
+    const Arena* arena = pointer.m_Cached ? ArenaOf(this) : nullptr;
+    if (arena && pointer.m_Root == this && pointer.m_Generation == arena->getGeneration())
+      return *pointer.m_Node;
+
+    const Node& node = Follow(*this, pointer, pointer.size());
+    if (arena)
+    {
+      pointer.m_Root = this;
+      pointer.m_Node = &node;
+      pointer.m_Generation = arena->getGeneration();
+    }
+    return node;
+  }
+
+  Node& Node::at(const JsonPointer& pointer)
+  {
+    return const_cast<Node&>(std::as_const(*this).at(pointer));
+  }
+
   inline Node::operator const char*() const
   {
     if (type == NodeType::String)
-      return data.string.ptr;
+      return (flags & InlineString) ? data.inlined.chars : data.string.ptr;
     throw std::runtime_error("Node is not a string.");
   }
 
@@ -466,6 +1551,8 @@ namespace json
     switch (type)
     {
     case NodeType::Integer:
+      if (flags & UnsignedInteger)
+        throw std::runtime_error("Integer does not fit in int64_t.");
       return data.integer;
 
     case NodeType::Double:
@@ -487,6 +1574,8 @@ namespace json
     switch (type)
     {
     case NodeType::Integer:
+      if (flags & UnsignedInteger)
+        return (double)(uint64_t)data.integer;
       return (double)data.integer;
 
     case NodeType::Double:
@@ -496,6 +1585,24 @@ namespace json
     };
   }
 
+  std::string_view Node::getString() const
+  {
+    if (type != NodeType::String)
+      throw std::runtime_error("Node is not a string.");
+    if (flags & InlineString)
+      return std::string_view(data.inlined.chars, data.inlined.length);
+    return std::string_view(data.string.ptr, data.string.length);
+  }
+
+  uint64_t Node::getUnsigned() const
+  {
+    if (type != NodeType::Integer)
+      throw std::runtime_error("Node is not an integer.");
+    if (!(flags & UnsignedInteger) && data.integer < 0)
+      throw std::runtime_error("Integer is negative.");
+    return (uint64_t)data.integer;
+  }
+
   uint64_t Node::getSize() const
   {
     switch (type)
@@ -505,7 +1612,7 @@ namespace json
     case (NodeType::Object):
       return data.object.length;
     case (NodeType::String):
-      return data.string.length;
+      return (flags & InlineString) ? data.inlined.length : data.string.length;
     default:
       throw std::runtime_error("Node does not have a size.");
     }
@@ -3,15 +3,17 @@
 #include <cstring>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace json
 {
 
   class Node;
+  class JsonHandler;
   using Json = Node*;
 
-  enum class NodeType
+  enum class NodeType : uint8_t
   {
     None,
     Object,
@@ -24,6 +26,51 @@ namespace json
   };
 
   struct JsonMember;
+  struct MemberIndex;
+  struct MemberRef;
+  class KeyIndex;
+  class EditBatch;
+  class JsonPointer;
+
+  /**
+   * @brief Options controlling how the parser builds a json.
+   */
+  struct ParseOptions
+  {
+    /**
+     * @brief Strings that need no unescaping point into the parsed text instead of being copied. The text must outlive
+     * the json and such strings are not null terminated.
+     */
+    bool borrowStrings = false;
+
+    /**
+     * @brief Integers above INT64_MAX that still fit in 64 bits are kept exact as unsigned integers (see
+     * Node::UnsignedInteger) instead of being promoted to a double. Integers that fit in neither always become doubles.
+     */
+    bool keepLargeIntegersUnsigned = false;
+
+    /**
+     * @brief Deepest nesting of arrays and objects that is parsed. Deeper input fails with an exception, even when
+     * parsing partially, instead of using up memory.
+     */
+    std::size_t maxDepth = 1024;
+  };
+
+  /**
+   * @brief Outcome of JsonParser::Validate. Converts to true if the json is valid.
+   */
+  struct ValidationResult
+  {
+    bool valid = true;
+    std::size_t offset = 0;         // byte offset of the error
+    uint32_t line = 0, column = 0;  // position of the error, counted the same way the parser does
+    const char* expected = nullptr; // what the grammar expected at the error
+
+    explicit operator bool() const
+    {
+      return valid;
+    }
+  };
 
   struct Node
   {
@@ -43,7 +90,8 @@ namespace json
     operator int64_t() const;
 
     /**
-     * @brief Tries to cast the node to a const char*. Throws if the type is not Stirng.
+     * @brief Tries to cast the node to a const char*. Throws if the type is not Stirng. Borrowed strings are not null
+     * terminated, use getSize() or getString() for their length. Inline strings point into the node.
      */
     operator const char*() const;
 
@@ -69,13 +117,32 @@ namespace json
     Node& operator[](const std::string& index);
 
     /**
-     * @brief Returns the value inside the object at the specified key. Throws if index is invalid.
+     * @brief Returns the value inside the object at the specified key. Throws if index is invalid. If the key is
+     * repeated the first member with it is returned. Large objects are looked up in their key index.
      *
      * @param key Desired key.
      * @return const Node&
      */
     const Node& operator[](const std::string& key) const;
 
+    /**
+     * @brief Returns the node a pointer leads to, from the cache of the pointer if it has one that is still up to date.
+     * Throws if the pointer is incorrect, the same as operator[].
+     *
+     * @param pointer The pointer.
+     * @return Node&
+     */
+    Node& at(const JsonPointer& pointer);
+
+    /**
+     * @brief Returns the node a pointer leads to, from the cache of the pointer if it has one that is still up to date.
+     * Throws if the pointer is incorrect, the same as operator[].
+     *
+     * @param pointer The pointer.
+     * @return const Node&
+     */
+    const Node& at(const JsonPointer& pointer) const;
+
     /**
      * @brief Returns the size of array, object or string. If type is not an array, object or string throws.
      *
@@ -83,15 +150,34 @@ namespace json
      */
     std::size_t getSize() const;
 
+    /**
+     * @brief Returns the characters of a string. Throws if the type is not String.
+     *
+     * @return std::string_view
+     */
+    std::string_view getString() const;
+
+    /**
+     * @brief Returns the value of a non-negative integer, including ones above INT64_MAX. Throws if the type is not
+     * Integer or the value is negative.
+     *
+     * @return uint64_t
+     */
+    uint64_t getUnsigned() const;
+
   private:
     /**
      * @brief Helper for searching the json.
      *
      * @param key Search key.
-     * @param node Current node.
+     * @param interned The node the members of the document with the key share, nullptr to compare the characters.
+     * @param node Array or object to search.
+     * @param begin Index of the first member or element of node to search.
+     * @param end Index after the last member or element of node to search.
      * @param output Results.
      */
-    static void searchUtil(const char* key, const Node& node, std::vector<Node*>& output);
+    static void searchUtil(std::string_view key, const Node* interned, const Node& node, std::size_t begin,
+                           std::size_t end, std::vector<MemberRef>& output);
 
   public:
     /**
@@ -102,14 +188,42 @@ namespace json
      */
     Json search(const std::string& key) const;
 
+    /**
+     * @brief Searches for a key without copying anything.
+     *
+     * @param key Key to look for.
+     * @return Returns the members with that key in document order, they are valid as long as the json is not changed.
+     */
+    std::vector<MemberRef> find(std::string_view key) const;
+
+    /**
+     * @brief Searches for a key on several threads without copying anything. Worth it for large jsons only.
+     *
+     * @param key Key to look for.
+     * @param threadCount Number of threads, 0 uses one per hardware thread.
+     * @return Returns the members with that key in document order, the same as find.
+     */
+    std::vector<MemberRef> findParallel(std::string_view key, unsigned threadCount = 0) const;
+
     /**
      * @brief Edits a key.
      *
      * @param path The path of the key.
      * @param json The json to replace the current value with.
      * @param fullParse Set to false if you want the parser to try and fix the json if it cannot be normally parsed.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
      */
-    void edit(const std::string& path, const std::string& json, bool fullParse = true);
+    void edit(const std::string& path, const std::string& json, bool fullParse = true, KeyIndex* index = nullptr);
+
+    /**
+     * @brief Edits a key or an array element.
+     *
+     * @param path The pointer to the key or element.
+     * @param json The json to replace the current value with.
+     * @param fullParse Set to false if you want the parser to try and fix the json if it cannot be normally parsed.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
+     */
+    void edit(const JsonPointer& path, const std::string& json, bool fullParse = true, KeyIndex* index = nullptr);
 
     /**
      * @brief Creates a new member with a key and a json. The path will be created recursively if it does not exist.
@@ -118,25 +232,130 @@ namespace json
      * @param key The key of the new member.
      * @param json The json value of the new member.
      * @param fullParse Set to false if you want the parser to try and fix the json if it cannot be normally parsed.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
+     */
+    void create(const std::string& path, const std::string& key, const std::string& json, bool fullParse = true,
+                KeyIndex* index = nullptr);
+
+    /**
+     * @brief Makes the changes of a batch. Every path is looked up once however many changes go through it and every
+     * object gets room for all the members added to it at once. Throws without changing anything if a change does not
+     * fit the json, a json does not parse or two changes conflict, see EditBatch.
+     *
+     * @param batch The changes.
+     * @param index Index of the json to keep up to date with the changes, or nullptr.
+     */
+    void apply(const EditBatch& batch, KeyIndex* index = nullptr);
+
+    /**
+     * @brief Adds a json to the end of an array. Throws if the path is incorrect or does not lead to an array.
+     *
+     * @param path A forward slash separated path to the array, empty for this node.
+     * @param json The json value of the new element.
+     * @param fullParse Set to false if you want the parser to try and fix the json if it cannot be normally parsed.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
+     */
+    void append(const std::string& path, const std::string& json, bool fullParse = true, KeyIndex* index = nullptr);
+
+    /**
+     * @brief Inserts a json into an array before the element at a position. Throws if the path is incorrect, does not
+     * lead to an array or the position is past the end of the array.
+     *
+     * @param path A forward slash separated path to the array, empty for this node.
+     * @param position Index the new element will have, the length of the array appends it.
+     * @param json The json value of the new element.
+     * @param fullParse Set to false if you want the parser to try and fix the json if it cannot be normally parsed.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
      */
-    void create(const std::string& path, const std::string& key, const std::string& json, bool fullParse = true);
+    void insert(const std::string& path, std::size_t position, const std::string& json, bool fullParse = true,
+                KeyIndex* index = nullptr);
 
     /**
      * @brief Removes a key from the json. Throws if the path is incorrect.
      *
      * @param paths A forward slash separated path.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
      */
-    void remove(const std::string& paths);
+    void remove(const std::string& paths, KeyIndex* index = nullptr);
 
     /**
      * @brief Moves a all elements of a key to another. Throws if the path is incorrect.
      *
      * @param from A forward slash separated path.
      * @param to A forward slash separated path.
+     * @param index Index of the json to keep up to date with the change, or nullptr.
+     */
+    void move(const std::string& from, const std::string& to, KeyIndex* index = nullptr);
+
+    /**
+     * @brief The string data is not owned by the node, it points into the text the json was parsed from.
+     */
+    static constexpr uint32_t BorrowedString = 1 << 0;
+
+    /**
+     * @brief The node and everything it owns lives in the arena of its document and is freed together with it.
+     */
+    static constexpr uint32_t InArena = 1 << 1;
+
+    /**
+     * @brief The integer is above INT64_MAX and data.integer holds the bits of an uint64_t.
+     */
+    static constexpr uint32_t UnsignedInteger = 1 << 2;
+
+    /**
+     * @brief The characters of the string are stored in data.inlined instead of a buffer of their own, see
+     * InlineCapacity.
+     */
+    static constexpr uint32_t InlineString = 1 << 3;
+
+    /**
+     * @brief Longest string that is stored inside the node. The characters are null terminated.
+     */
+    static constexpr std::size_t InlineCapacity = 22;
+
+    /**
+     * @brief Stores the characters inside the node if they fit, see InlineCapacity. Otherwise returns false and
+     * data.string has to be set by the caller.
+     *
+     * @param str The characters of the string.
+     * @return Whether the characters were stored.
+     */
+    bool setInline(std::string_view str)
+    {
+      if (str.size() > InlineCapacity)
+        return false;
+      std::memcpy(data.inlined.chars, str.data(), str.size());
+      data.inlined.chars[str.size()] = '\0';
+      data.inlined.length = (uint8_t)str.size();
+      flags |= InlineString;
+      return true;
+    }
+
+    /**
+     * @brief Objects with at least this many members keep a hash index of their keys, so that looking a key up does not
+     * scan the members. Smaller objects are scanned.
+     */
+    static constexpr std::size_t IndexedObjectSize = 16;
+
+    /**
+     * @brief Builds or drops the key index of an object to match its current members. The parser and the functions
+     * editing objects call it, code changing data.object directly has to call it afterwards. Does nothing for other
+     * types.
+     */
+    void updateIndex();
+
+    /**
+     * @brief Makes room in an array or object for more elements or members, so that adding them does not move the ones
+     * it has. The room grows geometrically by itself when elements or members are added one at a time. Does nothing
+     * for other types.
+     *
+     * @param count Number of elements or members that will be added.
      */
-    void move(const std::string& from, const std::string& to);
+    void reserve(std::size_t count);
 
     NodeType type;
+    uint8_t capacityLog2; // the values of an array or object have room for 1 << capacityLog2 of them, for length if 0
+    uint32_t flags;
     union {
       bool boolean;
       std::int64_t integer;
@@ -148,10 +367,17 @@ namespace json
         const char* ptr;
       } string;
 
+      struct
+      {
+        char chars[InlineCapacity + 1];
+        uint8_t length;
+      } inlined; // as big as object, so short strings cost no space
+
       struct
       {
         std::size_t length;
         JsonMember** values;
+        MemberIndex* index; // nullptr unless the object has IndexedObjectSize members or more
       } object;
 
       struct
@@ -162,6 +388,8 @@ namespace json
     } data;
   };
 
+  static_assert(sizeof(Node::data) == Node::InlineCapacity + 2, "inline strings should fill the node");
+
   struct JsonMember
   {
     JsonMember() = default;
@@ -184,6 +412,25 @@ namespace json
     Node* node = nullptr;
   };
 
+  /**
+   * @brief A member of an object of a json, as returned by Node::find.
+   */
+  struct MemberRef
+  {
+    const Node* object;
+    std::size_t index;
+
+    const Node& getKey() const
+    {
+      return *object->data.object.values[index]->nameNode;
+    }
+
+    const Node& getValue() const
+    {
+      return *object->data.object.values[index]->node;
+    }
+  };
+
   class JsonParser
   {
   public:
@@ -192,18 +439,103 @@ namespace json
      * incorrect.
      *
      * @param text The text version of the json.
+     * @param options Options controlling how the json is built.
      * @return Json
      */
-    static Json Parse(const std::string& text);
+    static Json Parse(std::string_view text, const ParseOptions& options = ParseOptions());
 
     /**
      * @brief Parses a json file. If an error occurs tries to parse as much as it
      * can.
      *
      * @param text The text version of the json.
+     * @param options Options controlling how the json is built.
      * @return Json
      */
-    static Json ParsePartially(const std::string& text);
+    static Json ParsePartially(std::string_view text, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a json file straight from a memory mapping of it. Throws an exception if the file cannot be read or
+     * the format is incorrect. Strings are always copied since the mapping does not outlive the call.
+     *
+     * @param path Path to the file.
+     * @param options Options controlling how the json is built.
+     * @return Json
+     */
+    static Json ParseFile(const std::string& path, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a json file straight from a memory mapping of it. If an error occurs tries to parse as much as it
+     * can. Throws if the file cannot be read.
+     *
+     * @param path Path to the file.
+     * @param options Options controlling how the json is built.
+     * @return Json
+     */
+    static Json ParseFilePartially(const std::string& path, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a json on several threads. Only a top level array is split between the threads, see
+     * ParallelParser. Throws an exception if the format is incorrect.
+     *
+     * @param text The text version of the json.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the json is built.
+     * @return Json
+     */
+    static Json ParseParallel(std::string_view text, unsigned threadCount = 0,
+                              const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a json file straight from a memory mapping of it on several threads. Throws an exception if the file
+     * cannot be read or the format is incorrect.
+     *
+     * @param path Path to the file.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the json is built. Strings are always copied.
+     * @return Json
+     */
+    static Json ParseFileParallel(const std::string& path, unsigned threadCount = 0,
+                                  const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Checks whether a text is valid json without building anything. Follows RFC 8259 strictly, unlike the
+     * parser single quoted strings and missing or trailing commas are rejected, and strings have to be valid UTF-8.
+     * Nothing is allocated and nesting is limited to Validator::MaxDepth.
+     *
+     * @param text The text version of the json.
+     * @return ValidationResult
+     */
+    static ValidationResult Validate(std::string_view text);
+
+    /**
+     * @brief Checks whether a file is valid json straight from a memory mapping of it, see Validate. Throws if the file
+     * cannot be read.
+     *
+     * @param path Path to the file.
+     * @return ValidationResult
+     */
+    static ValidationResult ValidateFile(const std::string& path);
+
+    /**
+     * @brief Parses a json reporting its values to a handler instead of building a tree. Throws an exception if the
+     * format is incorrect, the handler may have received some of the values by then.
+     *
+     * @param text The text version of the json.
+     * @param handler Receives the values of the json, see JsonHandler.
+     * @param options Options controlling how the json is parsed.
+     */
+    static void Parse(std::string_view text, JsonHandler& handler, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a json file straight from a memory mapping of it, reporting its values to a handler instead of
+     * building a tree. Throws an exception if the file cannot be read or the format is incorrect.
+     *
+     * @param path Path to the file.
+     * @param handler Receives the values of the json, see JsonHandler.
+     * @param options Options controlling how the json is parsed.
+     */
+    static void ParseFile(const std::string& path, JsonHandler& handler, const ParseOptions& options = ParseOptions());
 
     /**
      * @brief Outputs the formatted json to std::cout.
@@ -247,7 +579,40 @@ namespace json
     static std::ostream& CompactPrint(Json json, std::ostream& outout);
 
     /**
-     * @brief Destroys a json object.
+     * @brief Outputs a member found by Node::find to the stream as an object holding only that member, formatted.
+     *
+     * @param member Member to print.
+     * @param output Output stream.
+     */
+    static std::ostream& PrettyPrint(const MemberRef& member, std::ostream& output);
+
+    /**
+     * @brief Outputs the members found by Node::find to the stream formatted, as the array Node::search would return.
+     *
+     * @param members Members to print.
+     * @param output Output stream.
+     */
+    static std::ostream& PrettyPrint(const std::vector<MemberRef>& members, std::ostream& output);
+
+    /**
+     * @brief Outputs a member found by Node::find to the stream as an object holding only that member, compactly.
+     *
+     * @param member Member to print.
+     * @param output Output stream.
+     */
+    static std::ostream& CompactPrint(const MemberRef& member, std::ostream& output);
+
+    /**
+     * @brief Outputs the members found by Node::find to the stream compactly, as the array Node::search would return.
+     *
+     * @param members Members to print.
+     * @param output Output stream.
+     */
+    static std::ostream& CompactPrint(const std::vector<MemberRef>& members, std::ostream& output);
+
+    /**
+     * @brief Destroys a json object. Freeing a parsed json releases its whole arena at once, nodes inside a parsed json
+     * are released together with it.
      *
      * @param json
      */
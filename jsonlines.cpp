@@ -0,0 +1,152 @@
+#include "jsonlines.h"
+#include "lexer.h"
+#include "mappedfile.h"
+#include "parser.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iterator>
+
+namespace json
+{
+  static constexpr std::size_t BatchSize = 256 * 1024;
+  static constexpr std::size_t BatchesPerThread = 4; // batches in flight, enough to keep the threads busy
+
+  /**
+   * @brief Lines of the text parsed by one task.
+   */
+  struct Batch
+  {
+    std::string_view text;
+    std::unique_ptr<Arena> arena;
+    std::vector<JsonRecord> records; // lines are counted from the start of the batch until the batch is handed out
+    std::size_t lineCount = 0;
+    std::future<void> done;
+  };
+
+  static bool IsBlank(std::string_view line)
+  {
+    return std::all_of(line.begin(), line.end(), Lexer::IsWhitespace);
+  }
+
+  /**
+   * @brief Returns the end of a batch starting at begin, right after the first newline that is at least BatchSize bytes
+   * away.
+   */
+  static const char* BatchEnd(const char* begin, const char* end)
+  {
+    if ((std::size_t)(end - begin) <= BatchSize)
+      return end;
+    const char* newline = (const char*)std::memchr(begin + BatchSize, '\n', end - begin - BatchSize);
+    return newline ? newline + 1 : end;
+  }
+
+  static void ParseBatch(Batch& batch, const ParseOptions& options)
+  {
+    const char* pos = batch.text.data();
+    const char* end = pos + batch.text.size();
+    Parser parser(std::string_view(), *batch.arena, true, options);
+    while (pos < end)
+    {
+      const char* newline = (const char*)std::memchr(pos, '\n', end - pos);
+      const char* lineEnd = newline ? newline : end;
+      std::string_view line(pos, lineEnd - pos);
+      if (!IsBlank(line))
+      {
+        JsonRecord& record = batch.records.emplace_back();
+        record.line = batch.lineCount;
+        try
+        {
+          record.value = parser.parseJson(line);
+        }
+        catch (const std::runtime_error& e)
+        {
+          record.error = e.what();
+        }
+      }
+      if (!newline)
+        break;
+      batch.lineCount++;
+      pos = newline + 1;
+    }
+  }
+
+  /**
+   * @brief Parses the batches of a text on a thread pool and hands them to consume in the order of the text, with the
+   * line numbers of the records made absolute.
+   */
+  static void ParseBatches(std::string_view text, unsigned threadCount, const ParseOptions& options,
+                           const std::function<void(Batch&)>& consume)
+  {
+    if (threadCount == 0)
+      threadCount = ThreadPool::DefaultThreadCount();
+    std::size_t batchCount = text.size() / BatchSize + 1;
+    threadCount = (unsigned)std::min<std::size_t>(threadCount, batchCount);
+
+    // The pool is destroyed first so that no task still uses a batch when they are freed.
+    std::deque<Batch> pending;
+    ThreadPool pool(threadCount);
+    const char* pos = text.data();
+    const char* end = pos + text.size();
+    std::size_t line = 1;
+    while (pos < end || !pending.empty())
+    {
+      while (pos < end && pending.size() < threadCount * BatchesPerThread)
+      {
+        const char* batchEnd = BatchEnd(pos, end);
+        Batch& batch = pending.emplace_back();
+        batch.text = std::string_view(pos, batchEnd - pos);
+        batch.arena.reset(new Arena());
+        batch.done = pool.submit([&batch, &options]() { ParseBatch(batch, options); });
+        pos = batchEnd;
+      }
+
+      Batch& batch = pending.front();
+      batch.done.get();
+      for (JsonRecord& record : batch.records)
+        record.line += line;
+      line += batch.lineCount;
+      consume(batch);
+      pending.pop_front();
+    }
+  }
+
+  JsonLines JsonLines::Parse(std::string_view text, unsigned threadCount, const ParseOptions& options)
+  {
+    JsonLines result;
+    ParseBatches(text, threadCount, options, [&result](Batch& batch) {
+      std::move(batch.records.begin(), batch.records.end(), std::back_inserter(result.m_Records));
+      result.m_Arenas.push_back(std::move(batch.arena));
+    });
+    return result;
+  }
+
+  JsonLines JsonLines::ParseFile(const std::string& path, unsigned threadCount, const ParseOptions& options)
+  {
+    MappedFile file(path);
+    ParseOptions fileOptions = options;
+    fileOptions.borrowStrings = false;
+    return Parse(file.getText(), threadCount, fileOptions);
+  }
+
+  void JsonLines::Parse(std::string_view text, const RecordCallback& callback, unsigned threadCount,
+                        const ParseOptions& options)
+  {
+    ParseBatches(text, threadCount, options, [&callback](Batch& batch) {
+      for (const JsonRecord& record : batch.records)
+        callback(record);
+    });
+  }
+
+  void JsonLines::ParseFile(const std::string& path, const RecordCallback& callback, unsigned threadCount,
+                            const ParseOptions& options)
+  {
+    // The mapping outlives every callback, so strings may be borrowed from it.
+    MappedFile file(path);
+    Parse(file.getText(), callback, threadCount, options);
+  }
+
+} // namespace json
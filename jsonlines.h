@@ -0,0 +1,114 @@
+#pragma once
+
+#include "arena.h"
+#include "json.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief One record of a newline delimited json.
+   */
+  struct JsonRecord
+  {
+    std::size_t line = 0; // line of the text the record is on, starting from 1
+    Json value = nullptr; // nullptr if the record could not be parsed
+    std::string error;    // why the record could not be parsed
+  };
+
+  /**
+   * @brief Parses newline delimited json (JSON Lines), where every non-blank line is a separate json. A raw newline can
+   * not appear inside a json string, so the text is split into batches of whole lines without looking at the json and
+   * the batches are parsed in parallel. Records come out in the order of the text either way. A record that does not
+   * parse gets an error message and does not stop the rest.
+   */
+  class JsonLines
+  {
+  public:
+    /**
+     * @brief Receives the records in the order of the text. The value of a record is freed once the callback returns,
+     * copy whatever is needed later.
+     */
+    using RecordCallback = std::function<void(const JsonRecord& record)>;
+
+    /**
+     * @brief Parses every record of a text.
+     *
+     * @param text The newline delimited json.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the records are built.
+     * @return JsonLines
+     */
+    static JsonLines Parse(std::string_view text, unsigned threadCount = 0, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses every record of a file straight from a memory mapping of it. Throws if the file cannot be read.
+     *
+     * @param path Path to the file.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the records are built. Strings are always copied.
+     * @return JsonLines
+     */
+    static JsonLines ParseFile(const std::string& path, unsigned threadCount = 0,
+                               const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a text and hands every record to a callback, called on the calling thread. Only a few batches per
+     * thread are kept in memory at a time, so texts of any size can be streamed through.
+     *
+     * @param text The newline delimited json.
+     * @param callback Receives the records.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the records are built.
+     */
+    static void Parse(std::string_view text, const RecordCallback& callback, unsigned threadCount = 0,
+                      const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a file straight from a memory mapping of it and hands every record to a callback. Throws if the file
+     * cannot be read.
+     *
+     * @param path Path to the file.
+     * @param callback Receives the records.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the records are built.
+     */
+    static void ParseFile(const std::string& path, const RecordCallback& callback, unsigned threadCount = 0,
+                          const ParseOptions& options = ParseOptions());
+
+    const std::vector<JsonRecord>& getRecords() const
+    {
+      return m_Records;
+    }
+
+    std::size_t getSize() const
+    {
+      return m_Records.size();
+    }
+
+    const JsonRecord& operator[](std::size_t idx) const
+    {
+      return m_Records[idx];
+    }
+
+    std::vector<JsonRecord>::const_iterator begin() const
+    {
+      return m_Records.begin();
+    }
+
+    std::vector<JsonRecord>::const_iterator end() const
+    {
+      return m_Records.end();
+    }
+
+  private:
+    std::vector<JsonRecord> m_Records;
+    std::vector<std::unique_ptr<Arena>> m_Arenas; // the records of a batch share an arena
+  };
+
+} // namespace json
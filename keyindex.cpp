@@ -0,0 +1,203 @@
+#include "keyindex.h"
+
+#include <algorithm>
+
+namespace json
+{
+  static bool IsContainer(const Node& node)
+  {
+    return node.type == NodeType::Array || node.type == NodeType::Object;
+  }
+
+  KeyIndex::KeyIndex(const Node& root) : m_Root(root)
+  {
+    Stack stack;
+    if (IsContainer(root))
+      stack.emplace_back(&root, 0);
+    walk(stack, nullptr, 0, Change::Build);
+  }
+
+  const std::vector<MemberRef>& KeyIndex::find(std::string_view key) const
+  {
+    static const std::vector<MemberRef> none;
+    auto it = m_Members.find(key);
+    return it == m_Members.end() ? none : it->second;
+  }
+
+  void KeyIndex::addMember(const Node& object, std::size_t position)
+  {
+    link();
+    Stack stack;
+    walk(stack, &object, position, Change::Add);
+  }
+
+  void KeyIndex::removeMember(const Node& object, std::size_t position)
+  {
+    link();
+    Stack stack;
+    walk(stack, &object, position, Change::Remove);
+  }
+
+  void KeyIndex::moveMember(const Node& object, std::size_t from, std::size_t to)
+  {
+    link();
+    const Node* child;
+    if (object.type == NodeType::Object)
+    {
+      const JsonMember& member = *object.data.object.values[to];
+      auto entry = m_Members.find(member.nameNode->getString());
+      if (entry != m_Members.end())
+      {
+        auto it = locate(entry->second, MemberRef{&object, from});
+        if (it != entry->second.end())
+          it->index = to;
+      }
+      child = member.node;
+    }
+    else
+      child = object.data.array.values[to];
+    if (IsContainer(*child))
+      m_Links[child].position = to;
+  }
+
+  void KeyIndex::link()
+  {
+    if (m_Linked)
+      return;
+    m_Linked = true;
+    m_Links.reserve(m_Containers);
+    Stack stack;
+    if (IsContainer(m_Root))
+      stack.emplace_back(&m_Root, 0);
+    walk(stack, nullptr, 0, Change::Link);
+  }
+
+  /**
+   * @brief Visits the member or element at the position of the container and everything in its value, depth first, then
+   * the rest of the containers on the stack. A null container starts with the stack.
+   */
+  void KeyIndex::walk(Stack& stack, const Node* container, std::size_t position, Change change)
+  {
+    std::vector<const Node*> unlinked; // links are still needed to find the members below them
+    while (true)
+    {
+      while (container == nullptr && !stack.empty())
+      {
+        std::pair<const Node*, std::size_t>& top = stack.back();
+        if (top.second == top.first->data.array.length) // same layout for objects
+        {
+          stack.pop_back();
+          continue;
+        }
+        container = top.first;
+        position = top.second++;
+      }
+      if (container == nullptr)
+        break;
+
+      const Node* child;
+      if (container->type == NodeType::Object && change == Change::Link)
+        child = container->data.object.values[position]->node;
+      else if (container->type == NodeType::Object)
+      {
+        const JsonMember& member = *container->data.object.values[position];
+        std::string_view name = member.nameNode->getString();
+        auto entry = m_Members.try_emplace(name).first;
+        std::vector<MemberRef>& members = entry->second;
+        MemberRef ref{container, position};
+        if (change == Change::Build)
+          members.push_back(ref); // the walk is in document order
+        else if (change == Change::Add)
+          members.insert(bound(members, ref, true), ref);
+        else
+        {
+          auto it = locate(members, ref);
+          if (it != members.end())
+            members.erase(it);
+          if (members.empty())
+            m_Members.erase(entry);
+          else if (entry->first.data() == name.data())
+            rekey(entry);
+        }
+        child = member.node;
+      }
+      else
+        child = container->data.array.values[position];
+
+      if (IsContainer(*child))
+      {
+        if (change == Change::Remove)
+          unlinked.push_back(child);
+        else if (change == Change::Build)
+          m_Containers++;
+        else
+          m_Links[child] = Link{container, position};
+        stack.emplace_back(child, 0);
+      }
+      container = nullptr;
+    }
+    for (const Node* node : unlinked)
+      m_Links.erase(node);
+  }
+
+  /**
+   * @brief Points the key of an entry at the name of its first member, when the member it pointed at is removed.
+   */
+  void KeyIndex::rekey(Members::iterator entry)
+  {
+    const MemberRef& first = entry->second.front();
+    std::string_view name = first.object->data.object.values[first.index]->nameNode->getString();
+    if (name.data() == entry->first.data()) // a key shared by the members of an arena
+      return;
+    auto node = m_Members.extract(entry);
+    node.key() = name;
+    m_Members.insert(std::move(node));
+  }
+
+  std::vector<MemberRef>::iterator KeyIndex::locate(std::vector<MemberRef>& members, const MemberRef& member)
+  {
+    auto it = bound(members, member, false);
+    if (it != members.end() && it->object == member.object && it->index == member.index)
+      return it;
+    return members.end();
+  }
+
+  void KeyIndex::pathOf(const Node* node, std::vector<std::size_t>& path) const
+  {
+    path.clear();
+    for (auto it = m_Links.find(node); it != m_Links.end(); it = m_Links.find(it->second.parent))
+      path.push_back(it->second.position);
+    std::reverse(path.begin(), path.end());
+  }
+
+  /**
+   * @brief Binary searches members in document order for the first one not before a member, or with upper the first one
+   * after it. A member comes before everything in its value. The path of the member is looked up once for the whole
+   * search, the paths of the members it is compared to reuse one buffer. Members of the same object are compared by
+   * their index alone, the paths of members of different objects never match.
+   */
+  std::vector<MemberRef>::iterator KeyIndex::bound(std::vector<MemberRef>& members, const MemberRef& member, bool upper)
+  {
+    bool hasPath = false;
+    auto compare = [&](const MemberRef& other) {
+      if (other.object == member.object)
+        return other.index < member.index ? -1 : other.index > member.index ? 1 : 0;
+      if (!hasPath)
+      {
+        pathOf(member.object, m_Path);
+        m_Path.push_back(member.index);
+        hasPath = true;
+      }
+      pathOf(other.object, m_OtherPath);
+      m_OtherPath.push_back(other.index);
+      bool before = std::lexicographical_compare(m_OtherPath.begin(), m_OtherPath.end(), m_Path.begin(), m_Path.end());
+      return before ? -1 : 1;
+    };
+    if (upper)
+      return std::upper_bound(members.begin(), members.end(), member,
+                              [&](const MemberRef&, const MemberRef& other) { return compare(other) > 0; });
+    return std::lower_bound(members.begin(), members.end(), member,
+                            [&](const MemberRef& other, const MemberRef&) { return compare(other) < 0; });
+  }
+
+} // namespace json
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief Maps every key of a json to the members with that key, so that searching for a key costs as much as the
+   * number of members found instead of a walk over the whole json. The index is built by walking the json once and is
+   * kept up to date by the changes that are given it, see Node::edit, Node::create, Node::remove and Node::move. Where
+   * the arrays and objects are is only needed to order the members of changes and is looked up by the first change.
+   */
+  class KeyIndex
+  {
+  public:
+    /**
+     * @brief Construct a new KeyIndex object
+     *
+     * @param root The json to index. Every change made to it afterwards must be given the index.
+     */
+    explicit KeyIndex(const Node& root);
+
+    KeyIndex(const KeyIndex& other) = delete;
+    KeyIndex& operator=(const KeyIndex& other) = delete;
+
+    /**
+     * @brief Returns the members with a key in document order, the same as Node::find on the root. The vector is valid
+     * until the index is changed.
+     *
+     * @param key Key to look for.
+     * @return const std::vector<MemberRef>&
+     */
+    const std::vector<MemberRef>& find(std::string_view key) const;
+
+    /**
+     * @brief Adds a member or element and everything in its value, after it was put at the position of the object or
+     * array.
+     *
+     * @param object Object or array of the json holding the member or element.
+     * @param position Index of the member or element.
+     */
+    void addMember(const Node& object, std::size_t position);
+
+    /**
+     * @brief Removes a member or element and everything in its value, before it is taken out of the object or array.
+     *
+     * @param object Object or array of the json holding the member or element.
+     * @param position Index of the member or element.
+     */
+    void removeMember(const Node& object, std::size_t position);
+
+    /**
+     * @brief Records that a member or element is now at another position of its object or array. When several members
+     * move towards the front they are given in the order of their new positions and towards the back in the reverse
+     * order, so that the members stay in the same order.
+     *
+     * @param object Object or array of the json holding the member or element.
+     * @param from Previous index of the member or element.
+     * @param to Current index of the member or element.
+     */
+    void moveMember(const Node& object, std::size_t from, std::size_t to);
+
+  private:
+    enum class Change
+    {
+      Build,
+      Link,
+      Add,
+      Remove
+    };
+
+    /**
+     * @brief Where an array or object is in the json.
+     */
+    struct Link
+    {
+      const Node* parent;
+      std::size_t position; // index of the member or element holding it
+    };
+
+    using Stack = std::vector<std::pair<const Node*, std::size_t>>;
+    using Members = std::unordered_map<std::string_view, std::vector<MemberRef>>;
+
+    void walk(Stack& stack, const Node* container, std::size_t position, Change change);
+    void link();
+    void rekey(Members::iterator entry);
+    std::vector<MemberRef>::iterator locate(std::vector<MemberRef>& members, const MemberRef& member);
+    std::vector<MemberRef>::iterator bound(std::vector<MemberRef>& members, const MemberRef& member, bool upper);
+    void pathOf(const Node* node, std::vector<std::size_t>& path) const;
+
+  private:
+    const Node& m_Root;
+    Members m_Members; // in document order, the keys view the name of one of their members
+    std::unordered_map<const Node*, Link> m_Links; // every array and object but the root, once the json is changed
+    std::size_t m_Containers = 0; // arrays and objects counted by the build
+    bool m_Linked = false;
+    std::vector<std::size_t> m_Path, m_OtherPath; // positions from the root of the members compared by bound
+  };
+
+} // namespace json
@@ -0,0 +1,78 @@
+#include "keytable.h"
+#include "arena.h"
+#include "json.h"
+
+namespace json
+{
+  KeyTable::KeyTable(Arena& arena, KeyTable* shared) : m_Arena(arena), m_Shared(shared)
+  {
+  }
+
+  Node* KeyTable::intern(std::string_view key, bool borrow)
+  {
+    auto it = m_Nodes.find(key);
+    if (it != m_Nodes.end())
+      return it->second;
+    if (m_Shared == nullptr)
+      return internLocked(key, borrow);
+
+    Node* node;
+    {
+      std::lock_guard<std::mutex> lock(m_Shared->m_Mutex);
+      node = m_Shared->internLocked(key, borrow);
+    }
+    m_Nodes.emplace(node->getString(), node);
+    m_Order.push_back(node);
+    return node;
+  }
+
+  Node* KeyTable::internLocked(std::string_view key, bool borrow)
+  {
+    auto it = m_Nodes.find(key);
+    if (it != m_Nodes.end())
+      return it->second;
+
+    Node* node = m_Arena.create<Node>();
+    node->type = NodeType::String;
+    node->flags = Node::InArena;
+    if (!node->setInline(key))
+    {
+      if (borrow)
+      {
+        node->flags |= Node::BorrowedString;
+        node->data.string.ptr = key.data();
+      }
+      else
+        node->data.string.ptr = m_Arena.copyString(key);
+      node->data.string.length = key.size();
+    }
+    m_Nodes.emplace(node->getString(), node);
+    m_Order.push_back(node);
+    return node;
+  }
+
+  void KeyTable::truncate(std::size_t count)
+  {
+    if (count == 0)
+    {
+      m_Nodes.clear();
+      m_Order.clear();
+      return;
+    }
+    while (m_Order.size() > count)
+    {
+      m_Nodes.erase(m_Order.back()->getString());
+      m_Order.pop_back();
+    }
+  }
+
+  void KeyTable::merge(const KeyTable& other)
+  {
+    for (Node* node : other.m_Order)
+    {
+      if (m_Nodes.emplace(node->getString(), node).second)
+        m_Order.push_back(node);
+    }
+  }
+
+} // namespace json
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace json
+{
+  class Arena;
+  class Node;
+
+  /**
+   * @brief Interns the keys of a document. Every distinct key is stored once as a string node in the arena of the
+   * document and every member with that key shares the node, so keys of the same document can be compared by pointer.
+   * Each arena has one, see Arena::getKeys().
+   */
+  class KeyTable
+  {
+  public:
+    /**
+     * @brief Construct a new KeyTable object
+     *
+     * @param arena The arena the key nodes are allocated in.
+     * @param shared A table filled from several threads that this one is a cache of, or nullptr. Keys are then looked up
+     * in this table first and only keys it has not seen yet are interned by the shared table under a lock, so every
+     * thread gets the same node for a key.
+     */
+    KeyTable(Arena& arena, KeyTable* shared = nullptr);
+
+    KeyTable(const KeyTable& other) = delete;
+    KeyTable& operator=(const KeyTable& other) = delete;
+
+    /**
+     * @brief Returns the node of a key, creating it if the key is new.
+     *
+     * @param key The characters of the key.
+     * @param borrow The characters outlive the document, the node may point to them instead of copying them.
+     * @return Node*
+     */
+    Node* intern(std::string_view key, bool borrow);
+
+    /**
+     * @brief Returns the node of a key, or nullptr if the document has no member with it.
+     *
+     * @param key The characters of the key.
+     * @return const Node*
+     */
+    const Node* find(std::string_view key) const
+    {
+      auto it = m_Nodes.find(key);
+      return it == m_Nodes.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Returns the number of keys, in the order they were interned.
+     */
+    std::size_t size() const
+    {
+      return m_Order.size();
+    }
+
+    /**
+     * @brief Forgets every key but the first count, used when the arena is rewound.
+     *
+     * @param count Number of keys that are kept.
+     */
+    void truncate(std::size_t count);
+
+    /**
+     * @brief Adds the keys of another table that this one does not have yet, used when an arena adopts another.
+     */
+    void merge(const KeyTable& other);
+
+  private:
+    Node* internLocked(std::string_view key, bool borrow);
+
+  private:
+    Arena& m_Arena;
+    KeyTable* m_Shared;
+    std::mutex m_Mutex; // taken by the tables caching this one
+    std::unordered_map<std::string_view, Node*> m_Nodes; // the views point to the characters of the nodes
+    std::vector<Node*> m_Order;
+  };
+
+} // namespace json
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace json
 {
@@ -9,7 +13,7 @@ namespace json
   {
   public:
     Lexer() = default;
-    Lexer(const std::string& text) : m_Text(text)
+    Lexer(std::string_view text) : m_Text(text)
     {
     }
 
@@ -29,58 +33,103 @@ namespace json
     {
       if (m_Idx + 1 > m_Text.size())
         return "";
-      if (std::min(charCount, m_Text.size() - m_Idx - 1) < 0)
-        return "";
-      return m_Text.substr(m_Idx, std::min(charCount, m_Text.size() - m_Idx));
+      return std::string(m_Text.substr(m_Idx, std::min<uint64_t>(charCount, m_Text.size() - m_Idx)));
     }
     void skipChar()
     {
       m_Idx++;
-      m_Column += 1;
     }
     void skipChars(uint64_t count)
     {
       m_Idx += count;
-      m_Column += count;
     }
     void skipWhitespace()
     {
-      while (peek() == ' ' || peek() == '\r' || peek() == '\n' || peek() == '\t')
+      if (m_Tokens != nullptr)
       {
-        m_Column += 1;
-        if (peek() == '\r' && peek(1) == '\n') // windows line endings KEKW
-        {
-          m_Column = 0;
-          m_Line += 1;
-          skipChars(2);
-        }
-        else if (peek() == '\r')
-        {
-          m_Column = 0;
-          m_Line += 1;
-        }
-        else if (peek() == '\n')
-        {
-          m_Column = 0;
-          m_Line += 1;
-        }
-        skipChar();
+        // Whitespace always ends at a token, so the whole run can be skipped at once.
+        if (m_Idx < m_Text.size() && IsWhitespace(m_Text[m_Idx]))
+          m_Idx = nextToken();
+        return;
       }
+      while (m_Idx < m_Text.size() && IsWhitespace(m_Text[m_Idx]))
+        m_Idx++;
     }
 
+    /**
+     * @brief Line and column are not tracked while lexing, they are derived from the current position when asked for.
+     */
     uint32_t getLine()
     {
+      computePosition();
       return m_Line;
     }
     uint32_t getColumn()
     {
+      computePosition();
       return m_Column;
     }
 
+    /**
+     * @brief Computes the line and column of an offset by counting the line breaks before it. A \r\n pair is one line
+     * break, lines start at 1 and columns at 0.
+     *
+     * @param text The text.
+     * @param offset Offset into the text.
+     * @param line Receives the line.
+     * @param column Receives the column.
+     */
+    static void GetPosition(std::string_view text, uint64_t offset, uint32_t& line, uint32_t& column)
+    {
+      line = 1;
+      uint64_t lineStart = 0;
+      for (uint64_t i = 0; i < offset && i < text.size(); i++)
+      {
+        if (IsLineBreak(text, i))
+        {
+          line++;
+          lineStart = i + 1;
+        }
+      }
+      column = (uint32_t)(offset - lineStart);
+    }
+
+    /**
+     * @brief Lets the lexer jump over whitespace and strings using the token positions of a StructuralIndex built for
+     * the same text.
+     *
+     * @param tokens Sorted token positions.
+     * @param count Number of positions.
+     */
+    void setTokens(const uint32_t* tokens, std::size_t count)
+    {
+      m_Tokens = tokens;
+      m_TokenCount = count;
+      m_TokenCursor = 0;
+    }
+
+    /**
+     * @brief Returns the number of characters between the quote at the current position and its closing quote, or -1
+     * if the lexer has no token positions or the string is not closed.
+     */
+    int64_t indexedStringLength()
+    {
+      if (m_Tokens == nullptr || nextToken() != m_Idx || m_TokenCursor + 1 >= m_TokenCount)
+        return -1;
+      uint64_t close = m_Tokens[m_TokenCursor + 1];
+      if (m_Text[close] != m_Text[m_Idx])
+        return -1;
+      return close - m_Idx - 1;
+    }
+
     const char* c_str() const
     {
       return m_Text.data() + m_Idx;
     }
+    const char* end() const
+    {
+      return m_Text.data() + m_Text.size();
+    }
 
     static bool IsNumber(char c)
     {
@@ -90,10 +139,63 @@ namespace json
     {
       return std::isalpha(c) || std::isdigit(c);
     }
+    static bool IsWhitespace(char c)
+    {
+      return c == ' ' || c == '\r' || c == '\n' || c == '\t';
+    }
+
+  private:
+    /**
+     * @brief Returns the position of the first token at or after the current position or the end of the text.
+     */
+    uint64_t nextToken()
+    {
+      while (m_TokenCursor < m_TokenCount && m_Tokens[m_TokenCursor] < m_Idx)
+        m_TokenCursor++;
+      return m_TokenCursor < m_TokenCount ? m_Tokens[m_TokenCursor] : m_Text.size();
+    }
+
+    static bool IsLineBreak(std::string_view text, uint64_t i)
+    {
+      return text[i] == '\n' || (text[i] == '\r' && (i + 1 >= text.size() || text[i + 1] != '\n'));
+    }
+
+    /**
+     * @brief Derives line and column of the current position. The first position is found by counting line breaks up to
+     * it. Partial parsing can report many errors, so from the second one on the start of every line is indexed once and
+     * looked up with a binary search.
+     */
+    void computePosition()
+    {
+      if (m_Idx == m_PositionIdx)
+        return;
+      if (m_PositionIdx == UINT64_MAX)
+        GetPosition(m_Text, m_Idx, m_Line, m_Column);
+      else
+      {
+        if (m_LineStarts.empty())
+        {
+          m_LineStarts.push_back(0);
+          for (uint64_t i = 0; i < m_Text.size(); i++)
+            if (IsLineBreak(m_Text, i))
+              m_LineStarts.push_back(i + 1);
+        }
+        uint64_t offset = std::min<uint64_t>(m_Idx, m_Text.size());
+        auto next = std::upper_bound(m_LineStarts.begin(), m_LineStarts.end(), offset);
+        m_Line = (uint32_t)(next - m_LineStarts.begin());
+        m_Column = (uint32_t)(offset - *(next - 1));
+      }
+      m_PositionIdx = m_Idx;
+    }
 
   private:
     uint32_t m_Line = 1, m_Column = 0;
+    uint64_t m_PositionIdx = UINT64_MAX; // the position m_Line and m_Column were computed for
+    std::vector<uint64_t> m_LineStarts;  // offset of every line, built once more than one position was asked for
     uint64_t m_Idx = 0;
-    std::string m_Text;
+    std::string_view m_Text;
+    const uint32_t* m_Tokens = nullptr;
+    std::size_t m_TokenCount = 0;
+    std::size_t m_TokenCursor = 0;
   };
-} // namespace json
\ No newline at end of file
+} // namespace json
@@ -0,0 +1,92 @@
+#include "mappedfile.h"
+
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JSON_HAS_MMAP 1
+#else
+#include <fstream>
+#define JSON_HAS_MMAP 0
+#endif
+
+namespace json
+{
+
+#if JSON_HAS_MMAP
+  MappedFile::MappedFile(const std::string& path)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Could not open " + path + ".");
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+      ::close(fd);
+      throw std::runtime_error("Could not read " + path + ".");
+    }
+    if (!S_ISREG(info.st_mode)) // pipes and devices have no size, read them until the end
+    {
+      char chunk[64 * 1024];
+      ssize_t count;
+      while ((count = ::read(fd, chunk, sizeof(chunk))) != 0)
+      {
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count < 0)
+        {
+          ::close(fd);
+          throw std::runtime_error("Could not read " + path + ".");
+        }
+        m_Buffer.append(chunk, (std::size_t)count);
+      }
+      ::close(fd);
+      m_Data = m_Buffer.data();
+      m_Size = m_Buffer.size();
+      return;
+    }
+
+    m_Size = (std::size_t)info.st_size;
+    if (m_Size == 0) // mmap rejects empty mappings
+    {
+      ::close(fd);
+      return;
+    }
+
+    void* data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (data == MAP_FAILED)
+      throw std::runtime_error("Could not map " + path + ".");
+    ::madvise(data, m_Size, MADV_SEQUENTIAL);
+    m_Data = (const char*)data;
+    m_Mapped = true;
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if (m_Mapped)
+      ::munmap((void*)m_Data, m_Size);
+  }
+#else
+  MappedFile::MappedFile(const std::string& path)
+  {
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+    if (!input.is_open())
+      throw std::runtime_error("Could not open " + path + ".");
+    m_Buffer.resize((std::size_t)input.tellg());
+    input.seekg(0);
+    input.read(&m_Buffer[0], m_Buffer.size());
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+  }
+
+  MappedFile::~MappedFile()
+  {
+  }
+#endif
+
+} // namespace json
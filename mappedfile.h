@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace json
+{
+  /**
+   * @brief A read-only view of a whole file. On POSIX systems regular files are memory mapped so that they can be parsed
+   * at page-cache speed, pipes and devices are read until their end. Elsewhere the file is read into memory in one go.
+   */
+  class MappedFile
+  {
+  public:
+    /**
+     * @brief Maps the file. Throws if the file cannot be opened or mapped.
+     *
+     * @param path Path to the file.
+     */
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    /**
+     * @brief Returns the contents of the file. The view is valid as long as the MappedFile is alive. Nothing past the
+     * end of the view may be read, the mapping is not padded.
+     *
+     * @return std::string_view
+     */
+    std::string_view getText() const
+    {
+      return std::string_view(m_Data, m_Size);
+    }
+
+  private:
+    const char* m_Data = nullptr;
+    std::size_t m_Size = 0;
+    bool m_Mapped = false;
+    std::string m_Buffer;
+  };
+} // namespace json
@@ -0,0 +1,148 @@
+#include "numberparser.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace json
+{
+  static bool IsDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  /**
+   * @brief Accumulates a run of digits into mantissa. Once the mantissa would overflow the remaining digits are only
+   * skipped and overflow is set.
+   */
+  static const char* ReadDigits(const char* pos, const char* end, uint64_t& mantissa, bool& overflow,
+                                int64_t& digitCount)
+  {
+    constexpr uint64_t MaxBeforeMultiply = std::numeric_limits<uint64_t>::max() / 10;
+    constexpr uint64_t MaxLastDigit = std::numeric_limits<uint64_t>::max() % 10;
+    const char* start = pos;
+    for (; pos < end && IsDigit(*pos); pos++)
+    {
+      uint64_t digit = *pos - '0';
+      if (overflow)
+        continue;
+      if (mantissa < MaxBeforeMultiply || (mantissa == MaxBeforeMultiply && digit <= MaxLastDigit))
+        mantissa = mantissa * 10 + digit;
+      else
+        overflow = true;
+    }
+    digitCount = pos - start;
+    return pos;
+  }
+
+  /**
+   * @brief Exact conversion for everything the fast path can not handle. std::from_chars rounds correctly, strtod is only
+   * used where the standard library lacks it for doubles or to tell overflow from underflow.
+   */
+  static double SlowPath(const char* begin, const char* end)
+  {
+#if defined(__cpp_lib_to_chars)
+    double value = 0.0;
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    if (result.ec == std::errc())
+      return value;
+    if (result.ec != std::errc::result_out_of_range)
+      return 0.0;
+#endif
+    return std::strtod(std::string(begin, end).c_str(), nullptr);
+  }
+
+  NumberParser::Result NumberParser::Parse(const char* begin, const char* end, bool keepUnsigned)
+  {
+    // Powers of ten that are exactly representable as a double.
+    static constexpr double ExactPowers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    constexpr uint64_t MaxExactMantissa = uint64_t(1) << 53;
+
+    Result result;
+    const char* pos = begin;
+    bool negative = pos < end && *pos == '-';
+    if (negative)
+      pos++;
+
+    uint64_t mantissa = 0;
+    bool overflow = false;
+    bool isInteger = true;
+    int64_t exponent = 0;
+    int64_t digitCount = 0;
+
+    if (pos == end || !IsDigit(*pos))
+      result.expected = "0-9";
+    else if (*pos == '0' && pos + 1 < end && IsDigit(pos[1]))
+    {
+      pos++;
+      result.expected = "./e/E"; // no leading zeros
+    }
+    else
+      pos = ReadDigits(pos, end, mantissa, overflow, digitCount);
+
+    if (result.expected == nullptr && pos < end && *pos == '.')
+    {
+      isInteger = false;
+      pos = ReadDigits(pos + 1, end, mantissa, overflow, digitCount);
+      if (digitCount == 0)
+        result.expected = "0-9";
+      exponent -= digitCount; // only used while there is no overflow
+    }
+
+    if (result.expected == nullptr && pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+      isInteger = false;
+      pos++;
+      bool negativeExponent = pos < end && *pos == '-';
+      if (pos < end && (*pos == '-' || *pos == '+'))
+        pos++;
+      int64_t explicitExponent = 0;
+      const char* digits = pos;
+      for (; pos < end && IsDigit(*pos); pos++)
+        if (explicitExponent < 100000) // anything beyond is infinity or zero anyway
+          explicitExponent = explicitExponent * 10 + (*pos - '0');
+      if (pos == digits)
+        result.expected = "0-9";
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    result.end = pos;
+
+    if (isInteger && !overflow)
+    {
+      constexpr uint64_t MinInt64Magnitude = uint64_t(std::numeric_limits<int64_t>::max()) + 1;
+      if (negative && mantissa <= MinInt64Magnitude)
+      {
+        result.kind = Kind::Integer;
+        result.integer = (int64_t)(0 - mantissa);
+        return result;
+      }
+      if (!negative && mantissa <= (uint64_t)std::numeric_limits<int64_t>::max())
+      {
+        result.kind = Kind::Integer;
+        result.integer = (int64_t)mantissa;
+        return result;
+      }
+      if (!negative && keepUnsigned)
+      {
+        result.kind = Kind::Unsigned;
+        result.unsignedInteger = mantissa;
+        return result;
+      }
+    }
+
+    result.kind = Kind::Double;
+    if (!overflow && mantissa <= MaxExactMantissa && exponent >= -22 && exponent <= 22)
+    {
+      // Both operands are exact, so the single rounding of the multiplication or division is the correct one.
+      double value = (double)mantissa;
+      value = exponent < 0 ? value / ExactPowers[-exponent] : value * ExactPowers[exponent];
+      result.dbl = negative ? -value : value;
+    }
+    else
+      result.dbl = SlowPath(begin, pos);
+    return result;
+  }
+
+} // namespace json
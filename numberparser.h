@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+namespace json
+{
+  /**
+   * @brief Parses json numbers straight from the input bytes without allocating.
+   */
+  class NumberParser
+  {
+  public:
+    enum class Kind
+    {
+      Integer,
+      Unsigned,
+      Double
+    };
+
+    struct Result
+    {
+      Kind kind = Kind::Integer;
+      union {
+        std::int64_t integer;
+        std::uint64_t unsignedInteger;
+        double dbl;
+      };
+
+      /**
+       * @brief One past the last character of the number. When the number is malformed this is the offending character.
+       */
+      const char* end = nullptr;
+
+      /**
+       * @brief What the grammar expected at end if the number is malformed, nullptr otherwise. The value is then parsed
+       * from the well formed prefix.
+       */
+      const char* expected = nullptr;
+    };
+
+    /**
+     * @brief Parses the number starting at begin. Integers that fit in an int64_t are parsed exactly. Larger ones are
+     * kept as an uint64_t if keepUnsigned is set and they fit, otherwise they are promoted to a double. Doubles take an
+     * exact fast path when the digits and the power of ten are both exactly representable, otherwise they are handed to
+     * std::from_chars.
+     *
+     * @param begin First character of the number, a '-' or a digit.
+     * @param end End of the text.
+     * @param keepUnsigned Keep integers between INT64_MAX and UINT64_MAX as unsigned.
+     * @return Result
+     */
+    static Result Parse(const char* begin, const char* end, bool keepUnsigned);
+  };
+
+} // namespace json
@@ -0,0 +1,498 @@
+#include "ondemand.h"
+#include "lexer.h"
+#include "mappedfile.h"
+#include "numberparser.h"
+#include "stringscanner.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_HAS_SSE2 1
+#else
+#define JSON_HAS_SSE2 0
+#endif
+
+namespace json
+{
+  static constexpr std::size_t npos = std::string_view::npos;
+
+  struct OnDemandRef::Source
+  {
+    std::string_view text;
+    ParseOptions options;
+    std::unique_ptr<MappedFile> file;
+    std::unordered_map<std::size_t, std::string> decoded; // strings with escape sequences by offset, never moved
+  };
+
+  static bool IsQuote(char c)
+  {
+    return c == '"' || c == '\'';
+  }
+
+  static bool IsDelimiter(char c)
+  {
+    return Lexer::IsWhitespace(c) || c == ',' || c == ':' || c == ']' || c == '}' || c == '[' || c == '{';
+  }
+
+  /**
+   * @brief Finds the first quote or bracket, 16 bytes at a time where SSE2 is available.
+   */
+  static const char* FindQuoteOrBracket(const char* pos, const char* end)
+  {
+#if JSON_HAS_SSE2
+    // Setting bit 0x20 maps [ and ] onto { and } and nothing else onto either.
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+    const __m128i doubleQuote = _mm_set1_epi8('"');
+    const __m128i singleQuote = _mm_set1_epi8('\'');
+    for (; end - pos >= 16; pos += 16)
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+      __m128i folded = _mm_or_si128(chunk, caseBit);
+      __m128i found = _mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace));
+      found = _mm_or_si128(found, _mm_or_si128(_mm_cmpeq_epi8(chunk, doubleQuote), _mm_cmpeq_epi8(chunk, singleQuote)));
+      int mask = _mm_movemask_epi8(found);
+      if (mask != 0)
+      {
+#if defined(__GNUC__) || defined(__clang__)
+        return pos + __builtin_ctz(mask);
+#else
+        break;
+#endif
+      }
+    }
+#endif
+    while (pos < end && !IsQuote(*pos) && *pos != '{' && *pos != '}' && *pos != '[' && *pos != ']')
+      pos++;
+    return pos;
+  }
+
+  /**
+   * @brief Returns one past the closing quote of the string whose opening quote is at pos, or nullptr if it is never
+   * closed. Control characters are not looked at.
+   */
+  static const char* SkipString(const char* pos, const char* end)
+  {
+    char quote = *pos++;
+    while (pos < end)
+    {
+      pos += StringScanner::FindSpecial(pos, end, quote);
+      if (pos == end)
+        break;
+      if (*pos == quote)
+        return pos + 1;
+      pos += *pos == '\\' ? 2 : 1;
+    }
+    return nullptr;
+  }
+
+  OnDemandDocument::OnDemandDocument(std::string_view text, const ParseOptions& options)
+    : m_Source(new OnDemandRef::Source())
+  {
+    m_Source->text = text;
+    m_Source->options = options;
+  }
+
+  OnDemandDocument::~OnDemandDocument() = default;
+  OnDemandDocument::OnDemandDocument(OnDemandDocument&& other) noexcept = default;
+  OnDemandDocument& OnDemandDocument::operator=(OnDemandDocument&& other) noexcept = default;
+
+  OnDemandDocument OnDemandDocument::ParseFile(const std::string& path, const ParseOptions& options)
+  {
+    std::unique_ptr<MappedFile> file(new MappedFile(path));
+    OnDemandDocument document(file->getText(), options);
+    document.m_Source->file = std::move(file);
+    return document;
+  }
+
+  OnDemandRef OnDemandDocument::getRoot() const
+  {
+    OnDemandRef root(m_Source.get(), 0);
+    root.m_Offset = root.skipWhitespace(0);
+    if (root.m_Offset == m_Source->text.size())
+      throw std::runtime_error("Document is empty.");
+    return root;
+  }
+
+  void OnDemandRef::error(std::size_t offset, const std::string& expected) const
+  {
+    std::string_view text = m_Source->text;
+    uint32_t line, column;
+    Lexer::GetPosition(text, offset, line, column);
+    std::string got(offset < text.size() ? text.substr(offset, 1) : std::string_view());
+    throw std::runtime_error("Unexpected character at " + std::to_string(line) + ":" +
+                             std::to_string(column) + ". Expected \"" + expected + "\" got " +
+                             (got.empty() ? "blank" : got) + ".\n");
+  }
+
+  std::size_t OnDemandRef::skipWhitespace(std::size_t offset) const
+  {
+    std::string_view text = m_Source->text;
+    while (offset < text.size() && Lexer::IsWhitespace(text[offset]))
+      offset++;
+    return offset;
+  }
+
+  std::size_t OnDemandRef::skip(std::size_t offset) const
+  {
+    std::string_view text = m_Source->text;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    if (offset >= text.size())
+      error(offset, "object/array/string/true/false/number/null");
+
+    char c = text[offset];
+    if (IsQuote(c))
+    {
+      const char* close = SkipString(begin + offset, end);
+      if (close == nullptr)
+        error(text.size(), std::string(1, c));
+      return close - begin;
+    }
+    if (c != '{' && c != '[')
+    {
+      std::size_t scalarEnd = offset;
+      while (scalarEnd < text.size() && !IsDelimiter(text[scalarEnd]) && !IsQuote(text[scalarEnd]))
+        scalarEnd++;
+      if (scalarEnd == offset)
+        error(offset, "object/array/string/true/false/number/null");
+      return scalarEnd;
+    }
+
+    // Only the nesting depth is tracked, mismatched brackets inside a skipped value are not noticed.
+    std::size_t depth = 0;
+    const char* pos = begin + offset;
+    while (true)
+    {
+      pos = FindQuoteOrBracket(pos, end);
+      if (pos == end)
+        error(text.size(), c == '{' ? "}" : "]");
+      if (IsQuote(*pos))
+      {
+        pos = SkipString(pos, end);
+        if (pos == nullptr)
+          error(text.size(), "\"");
+        continue;
+      }
+      if (*pos == '{' || *pos == '[')
+        depth++;
+      else if (--depth == 0)
+        return pos + 1 - begin;
+      pos++;
+    }
+  }
+
+  std::size_t OnDemandRef::first(char open) const
+  {
+    std::string_view text = m_Source->text;
+    if (text[m_Offset] != open)
+      throw std::runtime_error(open == '{' ? "Node is not an object." : "Node is not an array.");
+    std::size_t offset = skipWhitespace(m_Offset + 1);
+    if (offset < text.size() && text[offset] == (open == '{' ? '}' : ']'))
+      return npos;
+    if (offset >= text.size())
+      error(offset, open == '{' ? "}" : "]");
+    return offset;
+  }
+
+  std::size_t OnDemandRef::next(std::size_t offset, bool isObject) const
+  {
+    std::string_view text = m_Source->text;
+    offset = skipWhitespace(skip(isObject ? valueOf(offset) : offset));
+    if (offset < text.size() && text[offset] == ',')
+    {
+      offset = skipWhitespace(offset + 1);
+      if (offset >= text.size())
+        error(offset, "object/array/string/true/false/number/null");
+      return offset;
+    }
+    char close = isObject ? '}' : ']';
+    if (offset < text.size() && text[offset] == close)
+      return npos;
+    error(offset, std::string(",/") + close);
+  }
+
+  std::size_t OnDemandRef::valueOf(std::size_t offset) const
+  {
+    std::string_view text = m_Source->text;
+    if (offset >= text.size() || !IsQuote(text[offset]))
+      error(offset, "\"");
+    offset = skipWhitespace(skip(offset));
+    if (offset >= text.size() || text[offset] != ':')
+      error(offset, ":");
+    offset = skipWhitespace(offset + 1);
+    if (offset >= text.size())
+      error(offset, "object/array/string/true/false/number/null");
+    return offset;
+  }
+
+  std::string_view OnDemandRef::stringAt(std::size_t offset, std::string* buffer) const
+  {
+    std::string_view text = m_Source->text;
+    if (offset >= text.size() || !IsQuote(text[offset]))
+      throw std::runtime_error("Node is not a string.");
+    if (buffer == nullptr)
+    {
+      auto found = m_Source->decoded.find(offset);
+      if (found != m_Source->decoded.end())
+        return found->second;
+    }
+    char quote = text[offset];
+    const char* begin = text.data() + offset + 1;
+    const char* end = text.data() + text.size();
+    const char* pos = begin;
+    bool escaped = false;
+    while (true)
+    {
+      pos += StringScanner::FindSpecial(pos, end, quote);
+      if (pos == end)
+        error(text.size(), std::string(1, quote));
+      if (*pos == quote)
+        break;
+      if (*pos != '\\')
+        error(pos - text.data(), "string character");
+      escaped = true;
+      pos += end - pos > 1 ? 2 : 1;
+    }
+    if (!escaped)
+      return std::string_view(begin, pos - begin);
+
+    std::string decoded(pos - begin, '\0'); // escapes never decode to more bytes than they take
+    char* out = &decoded[0];
+    const char* in = begin;
+    while (in < pos)
+    {
+      if (*in != '\\')
+      {
+        *out++ = *in++;
+        continue;
+      }
+      if (!StringScanner::DecodeEscape(in, pos, out, quote))
+        error(in - text.data(), "escape sequence");
+    }
+    decoded.resize(out - &decoded[0]);
+    if (buffer != nullptr)
+    {
+      *buffer = std::move(decoded);
+      return *buffer;
+    }
+    return m_Source->decoded.emplace(offset, std::move(decoded)).first->second;
+  }
+
+  NodeType OnDemandRef::getType() const
+  {
+    std::string_view text = m_Source->text;
+    switch (text[m_Offset])
+    {
+    case '{':
+      return NodeType::Object;
+    case '[':
+      return NodeType::Array;
+    case '"':
+    case '\'':
+      return NodeType::String;
+    case 't':
+      if (text.compare(m_Offset, 4, "true") != 0 || skip(m_Offset) != m_Offset + 4)
+        error(m_Offset, "true");
+      return NodeType::Boolean;
+    case 'f':
+      if (text.compare(m_Offset, 5, "false") != 0 || skip(m_Offset) != m_Offset + 5)
+        error(m_Offset, "false");
+      return NodeType::Boolean;
+    case 'n':
+      if (text.compare(m_Offset, 4, "null") != 0 || skip(m_Offset) != m_Offset + 4)
+        error(m_Offset, "null");
+      return NodeType::Null;
+    default:
+      if (!Lexer::IsNumber(text[m_Offset]))
+        error(m_Offset, "object/array/string/true/false/number/null");
+      NumberParser::Result number = NumberParser::Parse(text.data() + m_Offset, text.data() + text.size(),
+                                                        m_Source->options.keepLargeIntegersUnsigned);
+      return number.kind == NumberParser::Kind::Double ? NodeType::Double : NodeType::Integer;
+    }
+  }
+
+  /**
+   * @brief Parses the number at offset, throwing if it is malformed.
+   */
+  static NumberParser::Result ParseNumber(std::string_view text, std::size_t offset, bool keepUnsigned)
+  {
+    NumberParser::Result number = NumberParser::Parse(text.data() + offset, text.data() + text.size(), keepUnsigned);
+    const char* end = text.data() + text.size();
+    if (number.expected == nullptr && number.end < end && !IsDelimiter(*number.end))
+      number.expected = "number";
+    return number;
+  }
+
+  bool OnDemandRef::isUnsigned() const
+  {
+    std::string_view text = m_Source->text;
+    if (!Lexer::IsNumber(text[m_Offset]))
+      return false;
+    return ParseNumber(text, m_Offset, m_Source->options.keepLargeIntegersUnsigned).kind ==
+           NumberParser::Kind::Unsigned;
+  }
+
+  OnDemandRef::operator bool() const
+  {
+    std::string_view text = m_Source->text;
+    if (text.compare(m_Offset, 4, "true") == 0 && skip(m_Offset) == m_Offset + 4)
+      return true;
+    if (text.compare(m_Offset, 5, "false") == 0 && skip(m_Offset) == m_Offset + 5)
+      return false;
+    throw std::runtime_error("Node is not a boolean.");
+  }
+
+  OnDemandRef::operator int64_t() const
+  {
+    std::string_view text = m_Source->text;
+    if (!Lexer::IsNumber(text[m_Offset]))
+      throw std::runtime_error("Node is not a number.");
+    NumberParser::Result number = ParseNumber(text, m_Offset, m_Source->options.keepLargeIntegersUnsigned);
+    if (number.expected != nullptr)
+      error(number.end - text.data(), number.expected);
+    switch (number.kind)
+    {
+    case NumberParser::Kind::Integer:
+      return number.integer;
+    case NumberParser::Kind::Unsigned:
+      throw std::runtime_error("Integer does not fit in int64_t.");
+    default:
+      return (int64_t)number.dbl;
+    }
+  }
+
+  OnDemandRef::operator double() const
+  {
+    std::string_view text = m_Source->text;
+    if (!Lexer::IsNumber(text[m_Offset]))
+      throw std::runtime_error("Node is not a number.");
+    NumberParser::Result number = ParseNumber(text, m_Offset, m_Source->options.keepLargeIntegersUnsigned);
+    if (number.expected != nullptr)
+      error(number.end - text.data(), number.expected);
+    switch (number.kind)
+    {
+    case NumberParser::Kind::Integer:
+      return (double)number.integer;
+    case NumberParser::Kind::Unsigned:
+      return (double)number.unsignedInteger;
+    default:
+      return number.dbl;
+    }
+  }
+
+  uint64_t OnDemandRef::getUnsigned() const
+  {
+    std::string_view text = m_Source->text;
+    if (!Lexer::IsNumber(text[m_Offset]))
+      throw std::runtime_error("Node is not an integer.");
+    NumberParser::Result number = ParseNumber(text, m_Offset, m_Source->options.keepLargeIntegersUnsigned);
+    if (number.expected != nullptr)
+      error(number.end - text.data(), number.expected);
+    switch (number.kind)
+    {
+    case NumberParser::Kind::Integer:
+      if (number.integer < 0)
+        throw std::runtime_error("Integer is negative.");
+      return (uint64_t)number.integer;
+    case NumberParser::Kind::Unsigned:
+      return number.unsignedInteger;
+    default:
+      throw std::runtime_error("Node is not an integer.");
+    }
+  }
+
+  OnDemandRef OnDemandRef::operator[](std::size_t idx) const
+  {
+    char tag = m_Source->text[m_Offset];
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node is not an array or an object.");
+    bool isObject = tag == '{';
+    std::size_t offset = first(tag);
+    for (std::size_t i = 0; i < idx && offset != npos; i++)
+      offset = next(offset, isObject);
+    if (offset == npos)
+      throw std::runtime_error("Invalid element index.");
+    return OnDemandRef(m_Source, isObject ? valueOf(offset) : offset);
+  }
+
+  OnDemandRef OnDemandRef::operator[](std::string_view key) const
+  {
+    std::string buffer; // keys without escape sequences are compared in place, the others are decoded here
+    for (std::size_t offset = first('{'); offset != npos; offset = next(offset, true))
+      if (stringAt(offset, &buffer) == key)
+        return OnDemandRef(m_Source, valueOf(offset));
+    throw std::runtime_error("Invalid member index (" + std::string(key) + ").");
+  }
+
+  std::string_view OnDemandRef::getKey(std::size_t idx) const
+  {
+    std::size_t offset = first('{');
+    for (std::size_t i = 0; i < idx && offset != npos; i++)
+      offset = next(offset, true);
+    if (offset == npos)
+      throw std::runtime_error("Invalid element index.");
+    return stringAt(offset);
+  }
+
+  std::size_t OnDemandRef::getSize() const
+  {
+    char tag = m_Source->text[m_Offset];
+    if (IsQuote(tag))
+      return stringAt(m_Offset).size();
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node does not have a size.");
+    std::size_t count = 0;
+    for (std::size_t offset = first(tag); offset != npos; offset = next(offset, tag == '{'))
+      count++;
+    return count;
+  }
+
+  std::string_view OnDemandRef::getString() const
+  {
+    return stringAt(m_Offset);
+  }
+
+  std::string_view OnDemandRef::getRaw() const
+  {
+    return m_Source->text.substr(m_Offset, skip(m_Offset) - m_Offset);
+  }
+
+  OnDemandIterator OnDemandRef::begin() const
+  {
+    char tag = m_Source->text[m_Offset];
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node is not an array or an object.");
+    return OnDemandIterator(*this, first(tag), tag == '{');
+  }
+
+  OnDemandIterator OnDemandRef::end() const
+  {
+    char tag = m_Source->text[m_Offset];
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node is not an array or an object.");
+    return OnDemandIterator(*this, npos, tag == '{');
+  }
+
+  OnDemandRef OnDemandIterator::operator*() const
+  {
+    return OnDemandRef(m_Container.m_Source, m_IsObject ? m_Container.valueOf(m_Offset) : m_Offset);
+  }
+
+  std::string_view OnDemandIterator::getKey() const
+  {
+    if (!m_IsObject)
+      throw std::runtime_error("Node is not an object.");
+    return m_Container.stringAt(m_Offset);
+  }
+
+  OnDemandIterator& OnDemandIterator::operator++()
+  {
+    m_Offset = m_Container.next(m_Offset, m_IsObject);
+    return *this;
+  }
+
+} // namespace json
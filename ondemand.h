@@ -0,0 +1,260 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace json
+{
+  class MappedFile;
+  class OnDemandIterator;
+
+  /**
+   * @brief A read-only cursor to a value inside an OnDemandDocument. It is the offset of the value in the text, cheap to
+   * copy and valid as long as the document is alive. Moving the document does not invalidate it. Nothing is decoded
+   * until it is asked for and values that are passed over on the way are skipped by matching brackets, so they are not
+   * validated. The conversion operators are explicit so that indexing with string literals is not ambiguous.
+   */
+  class OnDemandRef
+  {
+  public:
+    /**
+     * @brief Returns the type of the value. Unsigned integers are reported as Integer, see isUnsigned(). Throws if the
+     * value does not start like any json value.
+     *
+     * @return NodeType
+     */
+    NodeType getType() const;
+
+    /**
+     * @brief Returns true if the value is an integer above INT64_MAX, see ParseOptions::keepLargeIntegersUnsigned.
+     */
+    bool isUnsigned() const;
+
+    /**
+     * @brief Tries to cast the value to a boolean. Throws if type is not Boolean.
+     */
+    explicit operator bool() const;
+
+    /**
+     * @brief Tries to cast the value to an integer. Throws if type is not Number(Integer, Double).
+     */
+    explicit operator int64_t() const;
+
+    /**
+     * @brief Tries to cast the value to a double. Throws if the type is not a Number(Integer, Double).
+     */
+    explicit operator double() const;
+
+    /**
+     * @brief Returns the element at the specified index inside an array or the value of the member at that index inside
+     * an object. Throws if index is invalid. The elements before it are skipped, so this is linear in the size of
+     * the text they take.
+     *
+     * @param idx Desired index.
+     * @return OnDemandRef
+     */
+    OnDemandRef operator[](std::size_t idx) const;
+
+    /**
+     * @brief Returns the value inside the object at the specified key. Throws if the key does not exist. The members
+     * before it are skipped, so this is linear in the size of the text they take.
+     *
+     * @param key Desired key.
+     * @return OnDemandRef
+     */
+    OnDemandRef operator[](std::string_view key) const;
+
+    /**
+     * @brief Returns the key of the member at the specified index inside the object. Throws if index is invalid.
+     *
+     * @param idx Desired index.
+     * @return std::string_view
+     */
+    std::string_view getKey(std::size_t idx) const;
+
+    /**
+     * @brief Returns the size of array, object or string. If type is not an array, object or string throws. Counting
+     * the elements skips the whole container.
+     *
+     * @return std::size_t
+     */
+    std::size_t getSize() const;
+
+    /**
+     * @brief Returns the characters of a string. Throws if the type is not String. Strings without escape sequences
+     * point into the text, decoded ones are kept by the document until it is destroyed. Neither is null terminated.
+     *
+     * @return std::string_view
+     */
+    std::string_view getString() const;
+
+    /**
+     * @brief Returns the value of a non-negative integer, including ones above INT64_MAX. Throws if the type is not
+     * Integer or the value is negative.
+     *
+     * @return uint64_t
+     */
+    uint64_t getUnsigned() const;
+
+    /**
+     * @brief Returns the raw text of the value, including quotes and brackets.
+     *
+     * @return std::string_view
+     */
+    std::string_view getRaw() const;
+
+    /**
+     * @brief Returns an iterator to the first element of an array or the first member of an object. Throws if the type
+     * is not Array or Object.
+     *
+     * @return OnDemandIterator
+     */
+    OnDemandIterator begin() const;
+
+    /**
+     * @brief Returns the iterator one past the last element of an array or member of an object.
+     *
+     * @return OnDemandIterator
+     */
+    OnDemandIterator end() const;
+
+  private:
+    struct Source;
+
+    OnDemandRef(Source* source, std::size_t offset) : m_Source(source), m_Offset(offset)
+    {
+    }
+
+    /**
+     * @brief Returns the offset of the first element or member key of the container, or npos if it is empty. Throws if
+     * the value is not a container of the given kind.
+     */
+    std::size_t first(char open) const;
+
+    /**
+     * @brief Moves from the offset of an element, or of the key of a member, to the next one. Returns npos after the
+     * last one.
+     */
+    std::size_t next(std::size_t offset, bool isObject) const;
+
+    /**
+     * @brief Returns the offset of the value of the member whose key starts at offset.
+     */
+    std::size_t valueOf(std::size_t offset) const;
+
+    /**
+     * @brief Returns the offset one past the value starting at offset.
+     */
+    std::size_t skip(std::size_t offset) const;
+
+    /**
+     * @brief Returns the offset of the first character at or after offset that is not whitespace.
+     */
+    std::size_t skipWhitespace(std::size_t offset) const;
+
+    /**
+     * @brief Returns the decoded string starting at the quote at offset. Decoded strings are kept by the document, once
+     * per offset, unless a buffer is given to hold them.
+     */
+    std::string_view stringAt(std::size_t offset, std::string* buffer = nullptr) const;
+
+    /**
+     * @brief Throws a parse error at the offset.
+     */
+    [[noreturn]] void error(std::size_t offset, const std::string& expected) const;
+
+  private:
+    Source* m_Source;
+    std::size_t m_Offset;
+
+    friend class OnDemandDocument;
+    friend class OnDemandIterator;
+  };
+
+  /**
+   * @brief Forward iterator over the elements of an array or the members of an object of an OnDemandDocument.
+   */
+  class OnDemandIterator
+  {
+  public:
+    /**
+     * @brief Returns the current element, or the value of the current member.
+     */
+    OnDemandRef operator*() const;
+
+    /**
+     * @brief Returns the key of the current member. Only valid when iterating an object.
+     */
+    std::string_view getKey() const;
+
+    OnDemandIterator& operator++();
+
+    bool operator==(const OnDemandIterator& other) const
+    {
+      return m_Offset == other.m_Offset;
+    }
+    bool operator!=(const OnDemandIterator& other) const
+    {
+      return m_Offset != other.m_Offset;
+    }
+
+  private:
+    OnDemandIterator(const OnDemandRef& container, std::size_t offset, bool isObject)
+      : m_Container(container), m_Offset(offset), m_IsObject(isObject)
+    {
+    }
+
+  private:
+    OnDemandRef m_Container;
+    std::size_t m_Offset; // the key of objects, the element of arrays, npos past the end
+    bool m_IsObject;
+
+    friend class OnDemandRef;
+  };
+
+  /**
+   * @brief A json that is only parsed where it is read. Opening it costs nothing, looking a value up walks the text from
+   * the start of its container and skips the values in between by matching brackets, and only the values that are
+   * actually read get decoded. Reading a few fields of a big document therefore costs about as much as the text in
+   * front of them, not the whole document. Errors are only found in the parts that are read.
+   */
+  class OnDemandDocument
+  {
+  public:
+    /**
+     * @brief Wraps a text without looking at it. The text must outlive the document.
+     *
+     * @param text The json text.
+     * @param options Options controlling how values are decoded.
+     */
+    explicit OnDemandDocument(std::string_view text, const ParseOptions& options = ParseOptions());
+    ~OnDemandDocument();
+
+    OnDemandDocument(OnDemandDocument&& other) noexcept;
+    OnDemandDocument& operator=(OnDemandDocument&& other) noexcept;
+
+    /**
+     * @brief Memory maps a file, which stays mapped as long as the document is alive. Throws if the file cannot be read.
+     *
+     * @param path Path to the file.
+     * @param options Options controlling how values are decoded.
+     * @return OnDemandDocument
+     */
+    static OnDemandDocument ParseFile(const std::string& path, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Returns a cursor to the root value. Throws if the text is blank.
+     *
+     * @return OnDemandRef
+     */
+    OnDemandRef getRoot() const;
+
+  private:
+    std::unique_ptr<OnDemandRef::Source> m_Source;
+  };
+
+} // namespace json
@@ -0,0 +1,108 @@
+#include "parallelparser.h"
+#include "eventparser.h"
+#include "lexer.h"
+#include "parser.h"
+#include "structural.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+namespace json
+{
+  static constexpr std::size_t MinParallelSize = 1024 * 1024;
+  static constexpr std::size_t RunsPerThread = 4; // more runs than threads evens out runs that parse slower
+
+  /**
+   * @brief A run other than the last one has to contain an element and can not end with a comma, otherwise the array
+   * had two commas in a row.
+   */
+  static bool IsCompleteRun(std::string_view run)
+  {
+    auto last = std::find_if_not(run.rbegin(), run.rend(), Lexer::IsWhitespace);
+    return last != run.rend() && *last != ',';
+  }
+
+  ParallelParser::ParallelParser(std::string_view text, Arena& arena, unsigned threadCount, const ParseOptions& options)
+    : m_Text(text), m_Arena(arena), m_ThreadCount(threadCount), m_Options(options)
+  {
+  }
+
+  Node* ParallelParser::parseJson()
+  {
+    unsigned threadCount = m_ThreadCount == 0 ? ThreadPool::DefaultThreadCount() : m_ThreadCount;
+    std::vector<std::size_t> splits;
+    if (threadCount < 2 || m_Text.size() < MinParallelSize ||
+        !StructuralIndex::SplitArray(m_Text, threadCount * RunsPerThread, splits) || splits.size() < 3)
+      return Parser(m_Text, m_Arena, true, m_Options).parseJson();
+
+    std::vector<std::unique_ptr<Arena>> arenas;
+    std::vector<Node*> runs;
+    if (!parseRuns(splits, threadCount, arenas, runs))
+    {
+      // Parse again on one thread so that the error has the right message and position.
+      return Parser(m_Text, m_Arena, true, m_Options).parseJson();
+    }
+
+    std::size_t length = 0;
+    for (Node* run : runs)
+      length += run->data.array.length;
+    Node* array = m_Arena.create<Node>();
+    array->type = NodeType::Array;
+    array->flags = Node::InArena;
+    array->data.array.length = length;
+    array->data.array.values = m_Arena.allocateArray<Node*>(length);
+    Node** out = array->data.array.values;
+    for (Node* run : runs)
+    {
+      if (run->data.array.length > 0)
+        std::memcpy(out, run->data.array.values, run->data.array.length * sizeof(Node*));
+      out += run->data.array.length;
+    }
+    for (std::unique_ptr<Arena>& arena : arenas)
+      m_Arena.adopt(*arena);
+    return array;
+  }
+
+  bool ParallelParser::parseRuns(const std::vector<std::size_t>& splits, unsigned threadCount,
+                                 std::vector<std::unique_ptr<Arena>>& arenas, std::vector<Node*>& runs)
+  {
+    std::size_t runCount = splits.size() - 1;
+    arenas.resize(runCount);
+    runs.resize(runCount);
+    std::vector<std::future<void>> done;
+    done.reserve(runCount);
+
+    m_Arena.getKeys(); // created before the runs share it
+    ThreadPool pool((unsigned)std::min<std::size_t>(threadCount, runCount));
+    for (std::size_t i = 0; i < runCount; i++)
+    {
+      done.push_back(pool.submit([this, &splits, &arenas, &runs, runCount, i]() {
+        std::string_view run = m_Text.substr(splits[i] + 1, splits[i + 1] - splits[i] - 1);
+        if (i + 1 < runCount && !IsCompleteRun(run))
+          throw std::runtime_error("Incomplete run.");
+        arenas[i].reset(new Arena());
+        arenas[i]->shareKeys(m_Arena);
+        Parser builder(run, *arenas[i], true, m_Options);
+        EventParser(run, builder, true, m_Options).parseElements();
+        runs[i] = builder.takeValue();
+      }));
+    }
+
+    bool valid = true;
+    for (std::future<void>& run : done)
+    {
+      try
+      {
+        run.get();
+      }
+      catch (const std::runtime_error&)
+      {
+        valid = false;
+      }
+    }
+    return valid;
+  }
+
+} // namespace json
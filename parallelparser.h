@@ -0,0 +1,53 @@
+#pragma once
+
+#include "arena.h"
+#include "json.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief Parses a json whose top level value is an array on several threads. StructuralIndex::SplitArray cuts the
+   * elements into runs, every run is parsed into an arena of its own and those arenas are adopted by the arena of the
+   * result once all runs are done. Anything else, and texts too small to be worth it, is parsed by a single Parser.
+   */
+  class ParallelParser
+  {
+  public:
+    /**
+     * @brief Construct a new ParallelParser object
+     *
+     * @param text The json text.
+     * @param arena The arena every node of the json ends up in.
+     * @param threadCount Number of threads parsing, 0 uses one per hardware thread.
+     * @param options Options controlling how the json is built.
+     */
+    ParallelParser(std::string_view text, Arena& arena, unsigned threadCount = 0,
+                   const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses the json. Throws an exception if the format is incorrect, the message is the same a Parser would
+     * give and the arena is left as it was.
+     *
+     * @return A Json.
+     */
+    Node* parseJson();
+
+  private:
+    /**
+     * @brief Parses the runs of elements between the splits, one arena per run. Returns false if a run is not valid.
+     */
+    bool parseRuns(const std::vector<std::size_t>& splits, unsigned threadCount,
+                   std::vector<std::unique_ptr<Arena>>& arenas, std::vector<Node*>& runs);
+
+  private:
+    std::string_view m_Text;
+    Arena& m_Arena;
+    unsigned m_ThreadCount;
+    ParseOptions m_Options;
+  };
+
+} // namespace json
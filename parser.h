@@ -1,16 +1,20 @@
 #pragma once
 
-#include "lexer.h"
+#include "arena.h"
+#include "handler.h"
+#include "json.h"
+#include "keytable.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace json
 {
-  class Node;
-  struct JsonMember;
-
-  class Parser
+  /**
+   * @brief Builds the Node tree of a json in an arena from the events of an EventParser.
+   */
+  class Parser : public JsonHandler
   {
   public:
     /**
@@ -18,122 +22,78 @@ namespace json
      * 
      * @param text The json text.
      * @param shouldThrow Set to false if you want to parse the json partially and want the parser to try and fix unparsable json-s.
+     * @param arena The arena every node of the json is allocated in.
+     * @param options Options controlling how the json is built.
      */
-    Parser(const std::string& text, bool shouldThrow = true);
+    Parser(std::string_view text, Arena& arena, bool shouldThrow = true, const ParseOptions& options = ParseOptions());
 
     /**
-     * @brief Parses the current json.
+     * @brief Parses the current json. If parsing throws the arena is rewound to where it was before.
      * 
      * @return A Json. 
      */
     Node* parseJson();
 
-  private:
-    /**
-     * @brief Parses an element.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return Node*
-     */
-    Node* parseElement();
-
     /**
-     * @brief Parses a value.
-     * Refer to https://www.json.org/json-en.html
+     * @brief Parses another json into the same arena, reusing the buffers of the parser. Meant for parsing many small
+     * jsons in a row.
      *
-     * @return Node*
-     */
-    Node* parseValue();
-
-    /**
-     * @brief Parses an object.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return Node*
-     */
-    Node* parseObject();
-
-    /**
-     * @brief Parses a string.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return Node*
+     * @param text The json text.
+     * @return A Json.
      */
-    Node* parseString();
+    Node* parseJson(std::string_view text);
 
     /**
-     * @brief Parses a number. The number length is checked.
-     * Refer to https://www.json.org/json-en.html
+     * @brief Returns the last completed value of events that were passed to the handler functions directly instead of
+     * through parseJson() and forgets about it.
      *
      * @return Node*
      */
-    Node* parseNumber();
+    Node* takeValue();
+
+    void onKey(std::string_view key) override;
+    void onEndObject(std::size_t memberCount) override;
+    void onEndArray(std::size_t elementCount) override;
+    void onString(std::string_view str) override;
+    void onInt64(int64_t value) override;
+    void onUnsigned(uint64_t value) override;
+    void onDouble(double value) override;
+    void onBool(bool value) override;
+    void onNull() override;
 
+  private:
     /**
-     * @brief Parses an array.
-     * Refer to https://www.json.org/json-en.html
+     * @brief Allocates a node of the given type in the arena.
      *
+     * @param type Type of the node.
      * @return Node*
      */
-    Node* parseArray();
+    Node* newNode(NodeType type);
 
     /**
-     * @brief Parses the members of an object.
-     * Refer to https://www.json.org/json-en.html
+     * @brief Allocates a string node. The characters are borrowed when the options allow it and they point into the
+     * text, otherwise they are copied into the arena.
      *
+     * @param str The characters of the string.
      * @return Node*
      */
-    Node* parseMembers();
-
-    /**
-     * @brief Parses a single member.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return JsonMember*
-     */
-    JsonMember* parseMember();
-
-    /**
-     * @brief Parses an integer.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return std::string
-     */
-    std::string parseInteger();
+    Node* newString(std::string_view str);
 
     /**
-     * @brief Parses the decimal part after the . of a float. Returns an empty string if there is not one.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return std::string
-     */
-    std::string parseDecimal();
-
-    /**
-     * @brief Parses the exomponent of a float. Returns an empty string if there is not one.
-     * Refer to https://www.json.org/json-en.html
-     *
-     * @return std::string
-     */
-    std::string parseExponent();
-
-    /**
-     * @brief Called whenever an error during parsing occurs. Throws an exeption if m_ShouldThrow is set and clears the
-     * allocated memory.
-     *
-     * @param expected What the parser actually exepcted.
-     * @param got What the parser received.
+     * @brief Returns whether the characters may be borrowed instead of copied: the options allow it and they point into
+     * the text.
      */
-    void error(const std::string& expected, const std::string& got);
+    bool canBorrow(std::string_view str) const;
 
   private:
-    std::vector<Node*> m_AllocatedNodes;
-    std::vector<JsonMember*> m_AllocatedMembers;
-    std::vector<JsonMember**> m_AllocatedMemberArrays;
-    std::vector<Node**> m_AllocatedNodeArrays;
-    std::vector<char*> m_AllocatedCharArrays;
+    std::string_view m_Text;
+    Arena& m_Arena;
+    Arena::Marker m_Mark;
+    std::vector<Node*> m_Values; // finished values of the arrays and objects being parsed, innermost last
+    std::vector<Node*> m_Keys;   // keys of the objects being parsed, innermost last
+    KeyTable& m_KeyTable;        // the key nodes of the arena, shared by every member with the same key
     bool m_ShouldThrow;
-    Lexer m_Lexer;
+    ParseOptions m_Options;
   };
 
-} // namespace json
\ No newline at end of file
+} // namespace json
@@ -0,0 +1,68 @@
+#include "pointer.h"
+
+#include <stdexcept>
+
+namespace json
+{
+  JsonPointer::JsonPointer(std::string_view pointer, bool cached) : m_Cached(cached)
+  {
+    if (pointer.empty())
+      return;
+    if (pointer[0] == '/')
+      pointer.remove_prefix(1);
+
+    std::string key;
+    for (std::size_t i = 0; i <= pointer.size(); i++)
+    {
+      if (i == pointer.size() || pointer[i] == '/')
+      {
+        std::size_t index = ParseIndex(key);
+        m_Tokens.push_back(Token{std::move(key), index});
+        key.clear();
+      }
+      else if (pointer[i] != '~')
+        key += pointer[i];
+      else if (i + 1 < pointer.size() && (pointer[i + 1] == '0' || pointer[i + 1] == '1'))
+        key += pointer[++i] == '0' ? '~' : '/';
+      else
+        throw std::runtime_error("Invalid pointer (" + std::string(pointer) + ").");
+    }
+  }
+
+  std::string JsonPointer::toString() const
+  {
+    std::string pointer;
+    for (const Token& token : m_Tokens)
+    {
+      pointer += '/';
+      for (char c : token.key)
+      {
+        if (c == '~')
+          pointer += "~0";
+        else if (c == '/')
+          pointer += "~1";
+        else
+          pointer += c;
+      }
+    }
+    return pointer;
+  }
+
+  /**
+   * @brief Reads a key as an array index, which is 0 or digits not starting with 0.
+   */
+  std::size_t JsonPointer::ParseIndex(std::string_view key)
+  {
+    if (key.empty() || (key.size() > 1 && key[0] == '0'))
+      return NoIndex;
+    std::size_t index = 0;
+    for (char c : key)
+    {
+      if (c < '0' || c > '9' || index > (NoIndex - 1 - (c - '0')) / 10)
+        return NoIndex;
+      index = index * 10 + (c - '0');
+    }
+    return index;
+  }
+
+} // namespace json
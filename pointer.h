@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+  struct Node;
+
+  /**
+   * @brief A path into a json that is split and unescaped once, so that it can be looked up again and again without
+   * copying anything, see Node::at. Written as a JSON Pointer: keys separated by forward slashes, where ~1 stands for a
+   * slash and ~0 for a tilde inside a key. A key made of digits is the index of an element when it meets an array. The
+   * leading slash may be left out, which makes the forward slash separated paths of Node::edit and the others pointers
+   * too. The empty pointer leads to the node it is looked up in.
+   */
+  class JsonPointer
+  {
+  public:
+    static constexpr std::size_t NoIndex = SIZE_MAX;
+
+    /**
+     * @brief Construct a new JsonPointer object. Throws if a ~ is not followed by 0 or 1.
+     *
+     * @param pointer The pointer, for example /users/0/name.
+     * @param cached Set to true to remember the node the pointer last led to, until its json is changed. A cached
+     * pointer must not be looked up on several threads at once.
+     */
+    explicit JsonPointer(std::string_view pointer, bool cached = false);
+
+    /**
+     * @brief Returns the number of keys.
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const
+    {
+      return m_Tokens.size();
+    }
+
+    /**
+     * @brief Returns a key without its escapes.
+     *
+     * @param i Index of the key.
+     * @return const std::string&
+     */
+    const std::string& getKey(std::size_t i) const
+    {
+      return m_Tokens[i].key;
+    }
+
+    /**
+     * @brief Returns a key as the index of an array element, or NoIndex if it is not one.
+     *
+     * @param i Index of the key.
+     * @return std::size_t
+     */
+    std::size_t getIndex(std::size_t i) const
+    {
+      return m_Tokens[i].index;
+    }
+
+    /**
+     * @brief Returns the pointer with a leading slash and its keys escaped again.
+     *
+     * @return std::string
+     */
+    std::string toString() const;
+
+  private:
+    struct Token
+    {
+      std::string key;
+      std::size_t index; // the key as an array index, NoIndex if it is not one
+    };
+
+    static std::size_t ParseIndex(std::string_view key);
+
+  private:
+    std::vector<Token> m_Tokens;
+    bool m_Cached;
+    mutable const Node* m_Root = nullptr; // node the pointer was last looked up in
+    mutable const Node* m_Node = nullptr; // node it led to
+    mutable uint64_t m_Generation = 0;    // generation of the arena of the json at the time
+
+    friend struct Node;
+  };
+
+} // namespace json
@@ -0,0 +1,417 @@
+#include "pushparser.h"
+#include "lexer.h"
+#include "numberparser.h"
+#include "stringscanner.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace json
+{
+  static bool IsNumberCharacter(char c)
+  {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+  }
+
+  PushParser::PushParser(const ParseOptions& options) : m_Handler(nullptr), m_Options(options), m_BuildTrees(true)
+  {
+    m_Options.borrowStrings = false;
+  }
+
+  PushParser::PushParser(JsonHandler& handler, const ParseOptions& options)
+    : m_Handler(&handler), m_Options(options), m_BuildTrees(false)
+  {
+  }
+
+  PushParser::~PushParser()
+  {
+    discardValue();
+    for (Json value : m_Values)
+      JsonParser::JsonFree(value);
+  }
+
+  void PushParser::feed(const char* data, std::size_t length)
+  {
+    if (m_Failed)
+      throw std::runtime_error("The push parser failed earlier.");
+    const char* pos = data;
+    const char* end = data + length;
+    m_Chunk = data;
+    while (pos < end)
+    {
+      switch (m_Token)
+      {
+      case Token::String:
+        pos = continueString(pos, end);
+        continue;
+      case Token::Number:
+        pos = continueNumber(pos, end);
+        continue;
+      case Token::Literal:
+        pos = continueLiteral(pos, end);
+        continue;
+      case Token::None:
+        break;
+      }
+
+      if (Lexer::IsWhitespace(*pos))
+      {
+        // Lines end the same as for Lexer::IsLineBreak, at \n, \r\n or a lone \r. A \r is counted right away, so the \n
+        // of a \r\n only moves the start of the line, also when it comes in the next chunk.
+        if (*pos == '\n' || *pos == '\r')
+        {
+          if (*pos == '\r' || !m_AfterCarriageReturn)
+            m_Line++;
+          m_LineStart = m_Offset + (pos - data) + 1;
+        }
+        m_AfterCarriageReturn = *pos == '\r';
+        m_NeedsWhitespace = false;
+        pos++;
+        continue;
+      }
+      m_AfterCarriageReturn = false;
+      mark(pos);
+      pos = parseStructural(pos);
+    }
+    m_Offset += length;
+    m_Chunk = nullptr;
+  }
+
+  void PushParser::finish()
+  {
+    if (m_Failed)
+      throw std::runtime_error("The push parser failed earlier.");
+    m_Position = m_Offset;
+    if (m_Token == Token::Number)
+    {
+      std::string number;
+      number.swap(m_Buffer);
+      m_Token = Token::None;
+      finishNumber(number.data(), number.data() + number.size());
+    }
+    if (m_Token != Token::None || !m_Containers.empty() || m_State != State::Value)
+      error("value", "EOF");
+    m_NeedsWhitespace = false;
+    m_AfterCarriageReturn = false;
+    m_Offset = 0;
+    m_Line = 1;
+    m_LineStart = 0;
+    m_Position = 0;
+  }
+
+  Json PushParser::next()
+  {
+    if (m_Values.empty())
+      return nullptr;
+    Json value = m_Values.front();
+    m_Values.pop_front();
+    return value;
+  }
+
+  const char* PushParser::parseStructural(const char* pos)
+  {
+    char c = *pos;
+    switch (m_State)
+    {
+    case State::ArrayNext:
+      if (c == ',')
+        m_State = State::Value;
+      else if (c == ']')
+        endContainer(']');
+      else
+        error(", or ]", std::string(1, c));
+      return pos + 1;
+    case State::ObjectNext:
+      if (c == ',')
+        m_State = State::ObjectKey;
+      else if (c == '}')
+        endContainer('}');
+      else
+        error(", or }", std::string(1, c));
+      return pos + 1;
+    case State::Colon:
+      if (c != ':')
+        error(":", std::string(1, c));
+      m_State = State::Value;
+      return pos + 1;
+    case State::ObjectFirst:
+    case State::ObjectKey:
+      if (c == '}' && m_State == State::ObjectFirst)
+      {
+        endContainer('}');
+        return pos + 1;
+      }
+      if (c != '"' && c != '\'')
+        error("\"", std::string(1, c));
+      m_Token = Token::String;
+      m_Quote = c;
+      m_IsKey = true;
+      m_Escaped = false;
+      m_HasEscapes = false;
+      return pos + 1;
+    case State::ArrayFirst:
+      if (c == ']')
+      {
+        endContainer(']');
+        return pos + 1;
+      }
+      break;
+    case State::Value:
+      break;
+    }
+
+    if (m_NeedsWhitespace)
+      error("whitespace", std::string(1, c));
+    if ((c == '{' || c == '[') && m_Containers.size() >= m_Options.maxDepth)
+      error("at most " + std::to_string(m_Options.maxDepth) + " nested values", std::string(1, c));
+    beginValue();
+    switch (c)
+    {
+    case '{':
+      m_Containers.push_back('{');
+      m_Counts.push_back(0);
+      m_State = State::ObjectFirst;
+      m_Handler->onStartObject();
+      return pos + 1;
+    case '[':
+      m_Containers.push_back('[');
+      m_Counts.push_back(0);
+      m_State = State::ArrayFirst;
+      m_Handler->onStartArray();
+      return pos + 1;
+    case '"':
+    case '\'':
+      m_Token = Token::String;
+      m_Quote = c;
+      m_IsKey = false;
+      m_Escaped = false;
+      m_HasEscapes = false;
+      return pos + 1;
+    case 't':
+      m_Literal = "true";
+      break;
+    case 'f':
+      m_Literal = "false";
+      break;
+    case 'n':
+      m_Literal = "null";
+      break;
+    default:
+      if (c == '-' || (c >= '0' && c <= '9'))
+      {
+        m_Token = Token::Number;
+        return pos;
+      }
+      error("object/array/string/true/false/number/null", std::string(1, c));
+    }
+    m_Token = Token::Literal;
+    m_LiteralLength = 0;
+    return pos;
+  }
+
+  const char* PushParser::continueString(const char* pos, const char* end)
+  {
+    while (pos < end)
+    {
+      if (m_Escaped)
+      {
+        m_Buffer.push_back(*pos++);
+        m_Escaped = false;
+        continue;
+      }
+      const char* special = pos + StringScanner::FindSpecial(pos, end, m_Quote);
+      if (special == end)
+      {
+        m_Buffer.append(pos, end);
+        return end;
+      }
+      if (*special == m_Quote)
+      {
+        if (m_Buffer.empty())
+          finishString(std::string_view(pos, special - pos)); // the whole string is inside this chunk
+        else
+        {
+          m_Buffer.append(pos, special);
+          finishString(m_Buffer);
+        }
+        return special + 1;
+      }
+      if (*special == '\\')
+      {
+        m_Buffer.append(pos, special + 1);
+        m_HasEscapes = true;
+        m_Escaped = true;
+        pos = special + 1;
+        continue;
+      }
+      mark(special);
+      error("string character", "control character " + std::to_string((int)*special));
+    }
+    return pos;
+  }
+
+  void PushParser::finishString(std::string_view raw)
+  {
+    std::string_view str = raw;
+    if (m_HasEscapes)
+    {
+      m_Decoded.resize(raw.size()); // escapes never decode to more bytes than they take
+      char* out = &m_Decoded[0];
+      const char* in = raw.data();
+      const char* end = raw.data() + raw.size();
+      while (in < end)
+      {
+        if (*in != '\\')
+        {
+          *out++ = *in++;
+          continue;
+        }
+        const char* escape = in;
+        if (!StringScanner::DecodeEscape(in, end, out, m_Quote))
+          error("escape sequence", std::string(escape, std::min<std::size_t>(end - escape, 2)));
+      }
+      str = std::string_view(m_Decoded.data(), out - m_Decoded.data());
+    }
+
+    m_Token = Token::None;
+    if (m_IsKey)
+    {
+      m_Handler->onKey(str);
+      m_State = State::Colon;
+    }
+    else
+    {
+      m_Handler->onString(str);
+      endValue();
+    }
+    m_Buffer.clear();
+  }
+
+  const char* PushParser::continueNumber(const char* pos, const char* end)
+  {
+    const char* numberEnd = pos;
+    while (numberEnd < end && IsNumberCharacter(*numberEnd))
+      numberEnd++;
+    if (numberEnd == end)
+    {
+      // The number may go on in the next chunk.
+      m_Buffer.append(pos, end);
+      return end;
+    }
+    m_Token = Token::None;
+    if (m_Buffer.empty())
+      finishNumber(pos, numberEnd);
+    else
+    {
+      m_Buffer.append(pos, numberEnd);
+      std::string number;
+      number.swap(m_Buffer);
+      finishNumber(number.data(), number.data() + number.size());
+    }
+    return numberEnd;
+  }
+
+  void PushParser::finishNumber(const char* begin, const char* end)
+  {
+    NumberParser::Result number = NumberParser::Parse(begin, end, m_Options.keepLargeIntegersUnsigned);
+    if (number.expected != nullptr || number.end != end)
+      error(number.expected ? number.expected : "number", std::string(begin, end));
+    switch (number.kind)
+    {
+    case NumberParser::Kind::Integer:
+      m_Handler->onInt64(number.integer);
+      break;
+    case NumberParser::Kind::Unsigned:
+      m_Handler->onUnsigned(number.unsignedInteger);
+      break;
+    case NumberParser::Kind::Double:
+      m_Handler->onDouble(number.dbl);
+      break;
+    }
+    endValue();
+  }
+
+  const char* PushParser::continueLiteral(const char* pos, const char* end)
+  {
+    std::size_t length = std::strlen(m_Literal);
+    while (pos < end && m_LiteralLength < length)
+    {
+      if (*pos != m_Literal[m_LiteralLength])
+      {
+        mark(pos);
+        error(m_Literal, std::string(1, *pos));
+      }
+      pos++;
+      m_LiteralLength++;
+    }
+    if (m_LiteralLength < length)
+      return pos;
+
+    m_Token = Token::None;
+    if (m_Literal[0] == 'n')
+      m_Handler->onNull();
+    else
+      m_Handler->onBool(m_Literal[0] == 't');
+    endValue();
+    return pos;
+  }
+
+  void PushParser::beginValue()
+  {
+    if (!m_BuildTrees || !m_Containers.empty())
+      return;
+    m_Arena.reset(new Arena());
+    m_Builder.reset(new Parser(std::string_view(), *m_Arena, true, m_Options));
+    m_Handler = m_Builder.get();
+  }
+
+  void PushParser::endValue()
+  {
+    if (m_Containers.empty())
+    {
+      m_State = State::Value;
+      m_NeedsWhitespace = true; // values run together are an error
+      if (m_BuildTrees)
+      {
+        Node* root = m_Builder->takeValue();
+        m_Arena->setRoot(root);
+        m_Arena.release(); // owned by the root from now on
+        m_Builder.reset();
+        m_Handler = nullptr;
+        m_Values.push_back(root);
+      }
+      return;
+    }
+    m_Counts.back()++;
+    m_State = m_Containers.back() == '{' ? State::ObjectNext : State::ArrayNext;
+  }
+
+  void PushParser::endContainer(char close)
+  {
+    std::size_t count = m_Counts.back();
+    m_Containers.pop_back();
+    m_Counts.pop_back();
+    if (close == '}')
+      m_Handler->onEndObject(count);
+    else
+      m_Handler->onEndArray(count);
+    endValue();
+  }
+
+  void PushParser::discardValue()
+  {
+    m_Builder.reset();
+    m_Arena.reset();
+  }
+
+  void PushParser::error(const std::string& expected, const std::string& got)
+  {
+    std::string res = "Unexpected character at " + std::to_string(m_Line) + ":" +
+                      std::to_string(m_Position - m_LineStart) + ". Expected \"" + expected + "\" got " +
+                      (got.empty() ? "blank" : got) + ".\n";
+    m_Failed = true;
+    discardValue();
+    throw std::runtime_error(res);
+  }
+
+} // namespace json
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "arena.h"
+#include "handler.h"
+#include "json.h"
+#include "parser.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief Parses a stream of json values that arrives in chunks of any size. Only the token that is cut by the end of a
+   * chunk is buffered, everything else is reported as soon as it is complete, so memory use does not grow with the
+   * stream. Values may follow each other, separated by whitespace. Unlike the other parsers the push parser does not try
+   * to fix broken json, the first error throws and leaves the parser unusable.
+   */
+  class PushParser
+  {
+  public:
+    /**
+     * @brief Creates a push parser that builds every top level value as a tree. Completed values are returned by next().
+     *
+     * @param options Options controlling how the json is built. Strings are always copied.
+     */
+    PushParser(const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Creates a push parser that reports the values to a handler as they are parsed.
+     *
+     * @param handler Receives the values, see JsonHandler.
+     * @param options Options controlling how the json is parsed.
+     */
+    PushParser(JsonHandler& handler, const ParseOptions& options = ParseOptions());
+    ~PushParser();
+
+    PushParser(const PushParser& other) = delete;
+    PushParser& operator=(const PushParser& other) = delete;
+
+    /**
+     * @brief Parses the next chunk of the stream. Throws an exception if the json is incorrect.
+     *
+     * @param data The bytes of the chunk, they are not referenced after the call returns.
+     * @param length Number of bytes.
+     */
+    void feed(const char* data, std::size_t length);
+
+    /**
+     * @brief Ends the stream. Completes a number that was waiting for more digits and throws if a value is incomplete.
+     * The parser can then be fed a new stream.
+     */
+    void finish();
+
+    /**
+     * @brief Returns the oldest completed value that has not been returned yet, or nullptr if there is none. The caller
+     * owns the value and frees it with JsonParser::JsonFree. Always nullptr when a handler was given.
+     *
+     * @return Json
+     */
+    Json next();
+
+  private:
+    enum class State
+    {
+      Value,       // any value
+      ArrayFirst,  // a value or ]
+      ArrayNext,   // , or ]
+      ObjectFirst, // a key or }
+      ObjectKey,   // a key
+      Colon,       // :
+      ObjectNext   // , or }
+    };
+
+    enum class Token
+    {
+      None,
+      String,
+      Number,
+      Literal
+    };
+
+    const char* parseStructural(const char* pos);
+    const char* continueString(const char* pos, const char* end);
+    const char* continueNumber(const char* pos, const char* end);
+    const char* continueLiteral(const char* pos, const char* end);
+
+    /**
+     * @brief Reports a complete string or key. raw still contains the escape sequences.
+     */
+    void finishString(std::string_view raw);
+    void finishNumber(const char* begin, const char* end);
+
+    /**
+     * @brief Called before the first event of a value, creates the tree builder of top level values.
+     */
+    void beginValue();
+
+    /**
+     * @brief Called after the last event of a value, moves on to what the enclosing container expects next.
+     */
+    void endValue();
+
+    void endContainer(char close);
+
+    /**
+     * @brief Throws a parse error at the current position and leaves the parser unusable.
+     *
+     * @param expected What the parser actually exepcted.
+     * @param got What the parser received.
+     */
+    [[noreturn]] void error(const std::string& expected, const std::string& got);
+
+    /**
+     * @brief Remembers a character of the current chunk as the position errors are reported at.
+     */
+    void mark(const char* pos)
+    {
+      m_Position = m_Offset + (pos - m_Chunk);
+    }
+
+    /**
+     * @brief Frees the tree of a value that was not completed.
+     */
+    void discardValue();
+
+  private:
+    JsonHandler* m_Handler;
+    ParseOptions m_Options;
+    bool m_BuildTrees;
+    bool m_Failed = false;
+
+    State m_State = State::Value;
+    std::vector<char> m_Containers;     // { or [ of every open container, innermost last
+    std::vector<std::size_t> m_Counts; // members or elements of every open container so far
+
+    Token m_Token = Token::None;
+    std::string m_Buffer;      // the part of the current token seen in earlier chunks
+    char m_Quote = '"';        // quote of the current string
+    bool m_IsKey = false;      // the current string is the key of a member
+    bool m_Escaped = false;    // the last character of the current string was a backslash
+    bool m_HasEscapes = false; // the current string contains escape sequences
+    const char* m_Literal = nullptr; // true, false or null
+    std::size_t m_LiteralLength = 0; // characters of m_Literal already matched
+    bool m_NeedsWhitespace = false;  // a top level value can not be followed directly by another value
+    std::string m_Decoded;
+
+    uint64_t m_Offset = 0; // stream offset of the chunk being parsed
+    const char* m_Chunk = nullptr;
+    uint64_t m_Line = 1;
+    uint64_t m_LineStart = 0;           // stream offset of the current line
+    bool m_AfterCarriageReturn = false; // the last character was a \r, which already ended the line
+    uint64_t m_Position = 0;            // stream offset of the token being looked at, for error messages
+
+    std::unique_ptr<Arena> m_Arena;   // arena of the top level value being built
+    std::unique_ptr<Parser> m_Builder;
+    std::deque<Json> m_Values; // completed top level values
+  };
+
+} // namespace json
@@ -0,0 +1,253 @@
+#include "stringscanner.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_HAS_SSE2 1
+#else
+#define JSON_HAS_SSE2 0
+#endif
+
+namespace json
+{
+  static bool IsSpecial(unsigned char c, char quote)
+  {
+    return c == (unsigned char)quote || c == '\\' || c < 0x20;
+  }
+
+  std::size_t StringScanner::FindSpecial(const char* begin, const char* end, const char* bufferEnd, char quote)
+  {
+    const char* pos = begin;
+#if JSON_HAS_SSE2
+    const __m128i quotes = _mm_set1_epi8(quote);
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    const __m128i lastControl = _mm_set1_epi8(0x1F);
+    for (; pos < end && bufferEnd - pos >= 16; pos += 16)
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+      __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quotes), _mm_cmpeq_epi8(chunk, backslashes));
+      special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, lastControl), chunk)); // chunk <= 0x1F
+      int mask = _mm_movemask_epi8(special);
+      if (mask != 0)
+      {
+#if defined(__GNUC__) || defined(__clang__)
+        return std::min<std::size_t>(pos - begin + __builtin_ctz(mask), end - begin);
+#else
+        break;
+#endif
+      }
+    }
+    if (pos >= end)
+      return end - begin;
+#endif
+    while (pos < end && !IsSpecial(*pos, quote))
+      pos++;
+    return pos - begin;
+  }
+
+  static int HexValue(char c)
+  {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  /**
+   * @brief Reads the four hex digits of a \uXXXX sequence starting at the backslash. Returns -1 if they are invalid.
+   */
+  static int32_t ReadUnicodeEscape(const char* in, const char* end)
+  {
+    if (end - in < 6 || in[0] != '\\' || in[1] != 'u')
+      return -1;
+    int32_t value = 0;
+    for (int i = 2; i < 6; i++)
+    {
+      int digit = HexValue(in[i]);
+      if (digit < 0)
+        return -1;
+      value = (value << 4) | digit;
+    }
+    return value;
+  }
+
+  bool StringScanner::DecodeEscape(const char*& in, const char* end, char*& out, char quote)
+  {
+    if (end - in < 2)
+      return false;
+    char c = in[1];
+    switch (c)
+    {
+    case '"':
+    case '\\':
+    case '/':
+      *out++ = c;
+      break;
+    case '\'':
+      if (quote != '\'')
+        return false;
+      *out++ = c;
+      break;
+    case 'b':
+      *out++ = '\b';
+      break;
+    case 'f':
+      *out++ = '\f';
+      break;
+    case 'n':
+      *out++ = '\n';
+      break;
+    case 'r':
+      *out++ = '\r';
+      break;
+    case 't':
+      *out++ = '\t';
+      break;
+    case 'u': {
+      int32_t codepoint = ReadUnicodeEscape(in, end);
+      if (codepoint < 0)
+        return false;
+      if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+      {
+        int32_t low = ReadUnicodeEscape(in + 6, end);
+        if (low >= 0xDC00 && low <= 0xDFFF)
+        {
+          out = EncodeUtf8(0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00), out);
+          in += 12;
+          return true;
+        }
+        codepoint = 0xFFFD;
+      }
+      else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+        codepoint = 0xFFFD;
+      out = EncodeUtf8(codepoint, out);
+      in += 6;
+      return true;
+    }
+    default:
+      return false;
+    }
+    in += 2;
+    return true;
+  }
+
+  std::size_t StringScanner::FindInvalidUtf8(const char* begin, const char* end)
+  {
+    const unsigned char* pos = (const unsigned char*)begin;
+    const unsigned char* last = (const unsigned char*)end;
+    while (pos < last)
+    {
+      if (last - pos >= 8)
+      {
+        uint64_t word;
+        std::memcpy(&word, pos, sizeof(word));
+        if ((word & 0x8080808080808080ULL) == 0)
+        {
+          pos += 8;
+          continue;
+        }
+      }
+      unsigned char c = *pos;
+      if (c < 0x80)
+      {
+        pos++;
+        continue;
+      }
+
+      int length;
+      uint32_t codepoint, min;
+      if ((c & 0xE0) == 0xC0)
+        length = 2, codepoint = c & 0x1F, min = 0x80;
+      else if ((c & 0xF0) == 0xE0)
+        length = 3, codepoint = c & 0x0F, min = 0x800;
+      else if ((c & 0xF8) == 0xF0)
+        length = 4, codepoint = c & 0x07, min = 0x10000;
+      else
+        break;
+      if (last - pos < length)
+        break;
+      int i = 1;
+      for (; i < length && (pos[i] & 0xC0) == 0x80; i++)
+        codepoint = (codepoint << 6) | (pos[i] & 0x3F);
+      if (i < length || codepoint < min || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+        break;
+      pos += length;
+    }
+    return (const char*)pos - begin;
+  }
+
+  char* StringScanner::EncodeUtf8(uint32_t codepoint, char* out)
+  {
+    if (codepoint < 0x80)
+      *out++ = (char)codepoint;
+    else if (codepoint < 0x800)
+    {
+      *out++ = (char)(0xC0 | (codepoint >> 6));
+      *out++ = (char)(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000)
+    {
+      *out++ = (char)(0xE0 | (codepoint >> 12));
+      *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+      *out++ = (char)(0x80 | (codepoint & 0x3F));
+    }
+    else
+    {
+      *out++ = (char)(0xF0 | (codepoint >> 18));
+      *out++ = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+      *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+      *out++ = (char)(0x80 | (codepoint & 0x3F));
+    }
+    return out;
+  }
+
+  std::ostream& StringScanner::WriteQuoted(std::ostream& output, std::string_view str)
+  {
+    static const char* Hex = "0123456789abcdef";
+    output << '"';
+    const char* pos = str.data();
+    const char* end = str.data() + str.size();
+    while (pos < end)
+    {
+      std::size_t run = FindSpecial(pos, end, '"');
+      output.write(pos, run);
+      pos += run;
+      if (pos == end)
+        break;
+      switch (*pos)
+      {
+      case '"':
+        output << "\\\"";
+        break;
+      case '\\':
+        output << "\\\\";
+        break;
+      case '\b':
+        output << "\\b";
+        break;
+      case '\f':
+        output << "\\f";
+        break;
+      case '\n':
+        output << "\\n";
+        break;
+      case '\r':
+        output << "\\r";
+        break;
+      case '\t':
+        output << "\\t";
+        break;
+      default:
+        output << "\\u00" << Hex[(*pos >> 4) & 0xF] << Hex[*pos & 0xF];
+        break;
+      }
+      pos++;
+    }
+    return output << '"';
+  }
+} // namespace json
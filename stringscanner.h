@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+namespace json
+{
+  /**
+   * @brief Helpers for scanning, decoding and encoding the contents of json strings.
+   */
+  class StringScanner
+  {
+  public:
+    /**
+     * @brief Finds the first byte that ends a run of plain string characters: the closing quote, a backslash or a control
+     * character. Scans 16 bytes at a time where SSE2 is available.
+     *
+     * @param begin First byte to look at.
+     * @param end One past the last byte to look at.
+     * @param quote The quote the string was opened with.
+     * @return Offset of the byte from begin, end - begin if there is none.
+     */
+    static std::size_t FindSpecial(const char* begin, const char* end, char quote)
+    {
+      return FindSpecial(begin, end, end, quote);
+    }
+
+    /**
+     * @brief Same as FindSpecial(begin, end, quote), but allowed to read (and ignore) bytes up to bufferEnd so that short
+     * strings followed by more text are still scanned a block at a time.
+     */
+    static std::size_t FindSpecial(const char* begin, const char* end, const char* bufferEnd, char quote);
+
+    /**
+     * @brief Decodes the escape sequence starting at the backslash in and writes it as UTF-8. \uXXXX escapes forming a
+     * surrogate pair are combined, unpaired surrogates become U+FFFD.
+     *
+     * @param in Points at the backslash, moved past the sequence on success.
+     * @param end One past the last byte of the input.
+     * @param out Output buffer, moved past the written bytes on success. At most as many bytes as the sequence is long
+     * are written.
+     * @param quote The quote the string was opened with. \' is only valid inside single quoted strings.
+     * @return Whether the sequence was valid.
+     */
+    static bool DecodeEscape(const char*& in, const char* end, char*& out, char quote);
+
+    /**
+     * @brief Checks that the bytes are well formed UTF-8: no stray continuation bytes, truncated or overlong sequences,
+     * surrogates or code points above U+10FFFF. ASCII is skipped 8 bytes at a time.
+     *
+     * @param begin First byte to look at.
+     * @param end One past the last byte to look at.
+     * @return Offset of the first byte of the first invalid sequence from begin, end - begin if there is none.
+     */
+    static std::size_t FindInvalidUtf8(const char* begin, const char* end);
+
+    /**
+     * @brief Writes a code point as UTF-8.
+     *
+     * @return One past the last written byte.
+     */
+    static char* EncodeUtf8(uint32_t codepoint, char* out);
+
+    /**
+     * @brief Writes the string surrounded by double quotes, escaping quotes, backslashes and control characters.
+     */
+    static std::ostream& WriteQuoted(std::ostream& output, std::string_view str);
+  };
+} // namespace json
@@ -0,0 +1,395 @@
+#include "structural.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define JSON_HAS_X86_SIMD 1
+#else
+#define JSON_HAS_X86_SIMD 0
+#endif
+
+namespace json
+{
+  namespace
+  {
+    /**
+     * @brief Bit i of each mask describes byte i of a 64 byte block.
+     */
+    struct BlockMasks
+    {
+      uint64_t quote;
+      uint64_t singleQuote;
+      uint64_t backslash;
+      uint64_t structural;
+      uint64_t whitespace;
+    };
+
+    using ClassifyFn = void (*)(const uint8_t* block, BlockMasks& masks);
+
+    void ClassifyScalar(const uint8_t* block, BlockMasks& masks)
+    {
+      masks = BlockMasks{};
+      for (int i = 0; i < 64; i++)
+      {
+        uint64_t bit = 1ULL << i;
+        switch (block[i])
+        {
+        case '"':
+          masks.quote |= bit;
+          break;
+        case '\'':
+          masks.singleQuote |= bit;
+          break;
+        case '\\':
+          masks.backslash |= bit;
+          break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+          masks.structural |= bit;
+          break;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+          masks.whitespace |= bit;
+          break;
+        }
+      }
+    }
+
+#if JSON_HAS_X86_SIMD
+    __attribute__((target("sse2"))) uint64_t Match16(const __m128i* chunks, char c)
+    {
+      __m128i needle = _mm_set1_epi8(c);
+      uint64_t result = 0;
+      for (int i = 0; i < 4; i++)
+        result |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)) << (i * 16);
+      return result;
+    }
+
+    __attribute__((target("sse2"))) void ClassifySse2(const uint8_t* block, BlockMasks& masks)
+    {
+      __m128i chunks[4];
+      for (int i = 0; i < 4; i++)
+        chunks[i] = _mm_loadu_si128((const __m128i*)(block + i * 16));
+      masks.quote = Match16(chunks, '"');
+      masks.singleQuote = Match16(chunks, '\'');
+      masks.backslash = Match16(chunks, '\\');
+      masks.structural = Match16(chunks, '{') | Match16(chunks, '}') | Match16(chunks, '[') | Match16(chunks, ']') |
+                         Match16(chunks, ':') | Match16(chunks, ',');
+      masks.whitespace = Match16(chunks, ' ') | Match16(chunks, '\t') | Match16(chunks, '\n') | Match16(chunks, '\r');
+    }
+
+    __attribute__((target("avx2"))) uint64_t Match32(__m256i low, __m256i high, char c)
+    {
+      __m256i needle = _mm256_set1_epi8(c);
+      uint64_t lowBits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, needle));
+      uint64_t highBits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, needle));
+      return lowBits | (highBits << 32);
+    }
+
+    __attribute__((target("avx2"))) void ClassifyAvx2(const uint8_t* block, BlockMasks& masks)
+    {
+      __m256i low = _mm256_loadu_si256((const __m256i*)block);
+      __m256i high = _mm256_loadu_si256((const __m256i*)(block + 32));
+      masks.quote = Match32(low, high, '"');
+      masks.singleQuote = Match32(low, high, '\'');
+      masks.backslash = Match32(low, high, '\\');
+      masks.structural = Match32(low, high, '{') | Match32(low, high, '}') | Match32(low, high, '[') |
+                         Match32(low, high, ']') | Match32(low, high, ':') | Match32(low, high, ',');
+      masks.whitespace =
+        Match32(low, high, ' ') | Match32(low, high, '\t') | Match32(low, high, '\n') | Match32(low, high, '\r');
+    }
+#endif
+
+    struct Implementation
+    {
+      const char* name;
+      ClassifyFn classify;
+      bool (*supported)();
+    };
+
+    const Implementation Implementations[] = {
+#if JSON_HAS_X86_SIMD
+      {"avx2", ClassifyAvx2, []() { return (bool)__builtin_cpu_supports("avx2"); }},
+#if defined(__x86_64__)
+      {"sse2", ClassifySse2, []() { return true; }}, // every x86-64 CPU has it
+#else
+      {"sse2", ClassifySse2, []() { return (bool)__builtin_cpu_supports("sse2"); }},
+#endif
+#endif
+      {"scalar", ClassifyScalar, []() { return true; }},
+    };
+
+    const Implementation* DetectImplementation()
+    {
+      for (const Implementation& implementation : Implementations)
+        if (implementation.supported())
+          return &implementation;
+      return nullptr; // unreachable, the scalar version is always supported
+    }
+
+    const Implementation* s_Implementation = DetectImplementation();
+
+    /**
+     * @brief Marks the bytes escaped by a backslash. Runs of backslashes escape each other, so only a backslash preceded
+     * by an even number of backslashes escapes the next byte.
+     *
+     * @param backslash Backslashes of the block.
+     * @param nextIsEscaped Whether the first byte of the block is escaped. Updated for the next block.
+     */
+    uint64_t FindEscaped(uint64_t backslash, uint64_t& nextIsEscaped)
+    {
+      constexpr uint64_t OddBits = 0xAAAAAAAAAAAAAAAAULL;
+      if (backslash == 0)
+      {
+        uint64_t escaped = nextIsEscaped;
+        nextIsEscaped = 0;
+        return escaped;
+      }
+      // Subtracting the start of each run from the odd bits carries through the run and flips exactly the bytes that
+      // end an odd length run, which are the escaped ones.
+      uint64_t potentialEscape = backslash & ~nextIsEscaped;
+      uint64_t maybeEscaped = potentialEscape << 1;
+      uint64_t escapeAndTerminal = ((maybeEscaped | OddBits) - potentialEscape) ^ OddBits;
+      uint64_t escaped = escapeAndTerminal ^ (backslash | nextIsEscaped);
+      uint64_t escape = escapeAndTerminal & backslash;
+      nextIsEscaped = escape >> 63;
+      return escaped;
+    }
+
+    uint64_t PrefixXor(uint64_t bits)
+    {
+      bits ^= bits << 1;
+      bits ^= bits << 2;
+      bits ^= bits << 4;
+      bits ^= bits << 8;
+      bits ^= bits << 16;
+      bits ^= bits << 32;
+      return bits;
+    }
+
+    /**
+     * @brief Index of the lowest set bit, 64 for zero.
+     */
+    int TrailingZeros(uint64_t bits)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return bits ? __builtin_ctzll(bits) : 64;
+#else
+      int count = 0;
+      while (count < 64 && !(bits & (1ULL << count)))
+        count++;
+      return count;
+#endif
+    }
+
+    int PopCount(uint64_t bits)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return __builtin_popcountll(bits);
+#else
+      int count = 0;
+      for (; bits; bits &= bits - 1)
+        count++;
+      return count;
+#endif
+    }
+  } // namespace
+
+  bool StructuralIndex::build(std::string_view text)
+  {
+    m_Size = 0;
+    if (text.size() >= UINT32_MAX)
+      return false;
+
+    if (m_Capacity < text.size() / 4 + 64) // a token every four bytes is typical for compact json
+      grow(text.size() / 4 + 64);
+
+    ClassifyFn classify = s_Implementation->classify;
+    const uint8_t* data = (const uint8_t*)text.data();
+    uint64_t nextIsEscaped = 0; // the first byte of the next block is escaped
+    uint64_t prevInString = 0;  // all ones if the previous block ended inside a string
+    uint64_t prevScalar = 0;    // the last byte of the previous block belongs to a scalar
+
+    uint8_t tail[64];
+    for (std::size_t offset = 0; offset < text.size(); offset += 64)
+    {
+      const uint8_t* block = data + offset;
+      if (text.size() - offset < 64) // never read past the end, pad the last block with whitespace
+      {
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, block, text.size() - offset);
+        block = tail;
+      }
+
+      BlockMasks masks;
+      classify(block, masks);
+
+      uint64_t escaped = FindEscaped(masks.backslash, nextIsEscaped);
+      uint64_t quotes = masks.quote & ~escaped;
+      uint64_t inString = PrefixXor(quotes) ^ prevInString; // opening quote and contents, not the closing quote
+      prevInString = (uint64_t)((int64_t)inString >> 63);
+
+      if (masks.singleQuote & ~inString)
+      {
+        m_Size = 0;
+        return false;
+      }
+
+      uint64_t structural = masks.structural & ~inString;
+      uint64_t scalar = ~(structural | masks.whitespace | quotes | inString);
+      uint64_t scalarStart = scalar & ~((scalar << 1) | prevScalar);
+      prevScalar = scalar >> 63;
+      uint64_t tokens = structural | quotes | scalarStart;
+
+      if (m_Capacity < m_Size + 64)
+        grow(m_Size + 64);
+      // Positions are written four at a time, the slots past the real count are garbage that the next block overwrites.
+      uint32_t* out = m_Positions.get() + m_Size;
+      std::size_t count = PopCount(tokens);
+      for (std::size_t i = 0; i < count; i += 4)
+      {
+        out[i] = (uint32_t)(offset + TrailingZeros(tokens));
+        tokens &= tokens - 1;
+        out[i + 1] = (uint32_t)(offset + TrailingZeros(tokens));
+        tokens &= tokens - 1;
+        out[i + 2] = (uint32_t)(offset + TrailingZeros(tokens));
+        tokens &= tokens - 1;
+        out[i + 3] = (uint32_t)(offset + TrailingZeros(tokens));
+        tokens &= tokens - 1;
+      }
+      m_Size += count;
+    }
+
+    // Padding is whitespace so it never produces tokens, but a scalar can not start past the end either.
+    while (m_Size > 0 && m_Positions[m_Size - 1] >= text.size())
+      m_Size--;
+    return true;
+  }
+
+  bool StructuralIndex::SplitArray(std::string_view text, std::size_t parts, std::vector<std::size_t>& splits)
+  {
+    splits.clear();
+    std::size_t spacing = text.size() / std::max<std::size_t>(parts, 1);
+    std::size_t nextSplit = 0; // the first comma at or past this offset ends a run
+    int64_t depth = 0;
+
+    ClassifyFn classify = s_Implementation->classify;
+    const uint8_t* data = (const uint8_t*)text.data();
+    uint64_t nextIsEscaped = 0;
+    uint64_t prevInString = 0;
+    bool seenValue = false; // the top level value has started
+
+    uint8_t tail[64];
+    for (std::size_t offset = 0; offset < text.size(); offset += 64)
+    {
+      const uint8_t* block = data + offset;
+      if (text.size() - offset < 64)
+      {
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, block, text.size() - offset);
+        block = tail;
+      }
+
+      BlockMasks masks;
+      classify(block, masks);
+      uint64_t escaped = FindEscaped(masks.backslash, nextIsEscaped);
+      uint64_t quotes = masks.quote & ~escaped;
+      uint64_t inString = PrefixXor(quotes) ^ prevInString;
+      prevInString = (uint64_t)((int64_t)inString >> 63);
+      if (masks.singleQuote & ~inString)
+        return false;
+
+      uint64_t structural = masks.structural & ~inString;
+      uint64_t other = ~(masks.structural | masks.whitespace) & ~inString; // quotes and scalars
+      if (!seenValue)
+      {
+        // The first byte that is not whitespace has to open the array.
+        uint64_t first = structural | other;
+        if (first == 0)
+          continue;
+        if (block[TrailingZeros(first)] != '[')
+          return false;
+        seenValue = true;
+      }
+
+      while (structural != 0)
+      {
+        int bit = TrailingZeros(structural);
+        std::size_t position = offset + bit;
+        switch (block[bit])
+        {
+        case '[':
+        case '{':
+          if (depth++ == 0)
+          {
+            splits.push_back(position);
+            nextSplit = position + spacing;
+          }
+          break;
+        case ']':
+        case '}':
+          if (--depth < 0)
+            return false;
+          if (depth == 0)
+          {
+            if (block[bit] != ']')
+              return false;
+            splits.push_back(position);
+            // Nothing but whitespace may follow.
+            uint64_t rest = (structural | other) & ~((2ULL << bit) - 1);
+            if (rest != 0)
+              return false;
+            for (std::size_t i = offset + 64; i < text.size(); i++)
+              if (text[i] != ' ' && text[i] != '\t' && text[i] != '\n' && text[i] != '\r')
+                return false;
+            return true;
+          }
+          break;
+        case ',':
+          if (depth == 1 && position >= nextSplit && splits.size() < parts)
+          {
+            splits.push_back(position);
+            nextSplit = position + spacing;
+          }
+          break;
+        }
+        structural &= structural - 1;
+      }
+    }
+    return false; // the array is never closed
+  }
+
+  void StructuralIndex::grow(std::size_t capacity)
+  {
+    capacity = std::max(capacity, m_Capacity * 2);
+    std::unique_ptr<uint32_t[]> positions(new uint32_t[capacity]);
+    if (m_Size > 0)
+      std::memcpy(positions.get(), m_Positions.get(), m_Size * sizeof(uint32_t));
+    m_Positions = std::move(positions);
+    m_Capacity = capacity;
+  }
+
+  const char* StructuralIndex::GetImplementation()
+  {
+    return s_Implementation->name;
+  }
+
+  bool StructuralIndex::SetImplementation(const std::string& name)
+  {
+    for (const Implementation& implementation : Implementations)
+      if (name == implementation.name && implementation.supported())
+      {
+        s_Implementation = &implementation;
+        return true;
+      }
+    return false;
+  }
+} // namespace json
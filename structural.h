@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief Positions of the tokens of a json text, found 64 bytes at a time with SIMD instructions. A token is a
+   * structural character ({}[]:,) or quote outside of a string, or the first byte of anything else (a number, a literal
+   * or garbage) that follows whitespace, a structural character or a quote. Every byte between two consecutive tokens
+   * is whitespace, string contents or the rest of a scalar.
+   */
+  class StructuralIndex
+  {
+  public:
+    /**
+     * @brief Indexes the text. Fails and leaves the index empty if the text is 4 GiB or larger or contains single quoted
+     * strings, which the scan does not understand.
+     *
+     * @param text The json text.
+     * @return Whether the text has been indexed.
+     */
+    bool build(std::string_view text);
+
+    const uint32_t* getPositions() const
+    {
+      return m_Positions.get();
+    }
+    std::size_t getSize() const
+    {
+      return m_Size;
+    }
+
+    /**
+     * @brief Frees the positions if room for more than maxCapacity of them is allocated.
+     */
+    void shrink(std::size_t maxCapacity)
+    {
+      if (m_Capacity > maxCapacity)
+      {
+        m_Positions.reset();
+        m_Capacity = 0;
+        m_Size = 0;
+      }
+    }
+
+    /**
+     * @brief Splits the elements of a top level array into runs of about equal size that can be parsed independently.
+     * Only the brackets and commas outside of strings are looked at, so this is much faster than parsing. Fails if the
+     * text is not an array, its brackets do not match or it contains single quoted strings.
+     *
+     * @param text The json text. Can be of any size.
+     * @param parts The number of runs wanted. Fewer are returned if the array has fewer elements.
+     * @param splits Receives the offsets of the opening bracket, the commas between runs and the closing bracket. Run i
+     * lies between splits[i] and splits[i + 1].
+     * @return Whether the text could be split.
+     */
+    static bool SplitArray(std::string_view text, std::size_t parts, std::vector<std::size_t>& splits);
+
+    /**
+     * @brief Returns the name of the implementation in use: "avx2", "sse2" or "scalar".
+     */
+    static const char* GetImplementation();
+
+    /**
+     * @brief Forces one of the implementations. Returns false if the CPU does not support it.
+     *
+     * @param name "avx2", "sse2" or "scalar".
+     */
+    static bool SetImplementation(const std::string& name);
+
+  private:
+    void grow(std::size_t capacity);
+
+  private:
+    std::unique_ptr<uint32_t[]> m_Positions; // left uninitialized, every text byte could be a token
+    std::size_t m_Capacity = 0;
+    std::size_t m_Size = 0;
+  };
+} // namespace json
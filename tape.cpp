@@ -0,0 +1,504 @@
+#include "tape.h"
+#include "mappedfile.h"
+#include "eventparser.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace json
+{
+  static constexpr int TagShift = 56;
+  static constexpr uint64_t PayloadMask = (uint64_t(1) << TagShift) - 1;
+
+  static char TagOf(uint64_t word)
+  {
+    return (char)(word >> TagShift);
+  }
+
+  static void MeasureScalar(const Node& node, std::size_t& words, std::size_t& chars)
+  {
+    switch (node.type)
+    {
+    case NodeType::Integer:
+    case NodeType::Double:
+      words += 2;
+      break;
+    case NodeType::String:
+      words += 1;
+      chars += sizeof(uint32_t) + node.getString().size() + 1;
+      break;
+    default:
+      words += 1;
+      break;
+    }
+  }
+
+  /**
+   * @brief Counts the tape words and string bytes needed for a json so that both buffers are allocated only once. The
+   * arrays and objects being counted are kept on an explicit stack, so any depth fits.
+   */
+  static void Measure(const Node& root, std::size_t& words, std::size_t& chars)
+  {
+    std::vector<std::pair<const Node*, std::size_t>> stack; // containers and the index of their next value
+    const Node* value = &root;
+    while (value != nullptr)
+    {
+      if (value->type == NodeType::Object || value->type == NodeType::Array)
+      {
+        words += 3;
+        stack.emplace_back(value, 0);
+      }
+      else
+        MeasureScalar(*value, words, chars);
+
+      value = nullptr;
+      while (value == nullptr && !stack.empty())
+      {
+        std::pair<const Node*, std::size_t>& top = stack.back();
+        const Node& node = *top.first;
+        if (top.second == node.data.array.length) // same layout for objects
+        {
+          stack.pop_back();
+          continue;
+        }
+        std::size_t i = top.second++;
+        if (node.type == NodeType::Object)
+        {
+          MeasureScalar(*node.data.object.values[i]->nameNode, words, chars);
+          value = node.data.object.values[i]->node;
+        }
+        else
+          value = node.data.array.values[i];
+      }
+    }
+  }
+
+  TapeDocument::TapeDocument(const Node& root)
+  {
+    std::size_t words = 0, chars = 0;
+    Measure(root, words, chars);
+    m_Tape.reserve(words);
+    m_Strings.reserve(chars);
+    append(root);
+  }
+
+  /**
+   * @brief Appends the values reported by an EventParser to a tape.
+   */
+  class TapeBuilder : public JsonHandler
+  {
+  public:
+    TapeBuilder(TapeDocument& document) : m_Document(document)
+    {
+    }
+
+    void onStartObject() override
+    {
+      m_Open.push_back(m_Document.m_Tape.size());
+      m_Document.appendOpen('{');
+    }
+    void onKey(std::string_view key) override
+    {
+      m_Document.appendString(key);
+    }
+    void onEndObject(std::size_t memberCount) override
+    {
+      m_Document.appendClose('}', m_Open.back(), memberCount);
+      m_Open.pop_back();
+    }
+    void onStartArray() override
+    {
+      m_Open.push_back(m_Document.m_Tape.size());
+      m_Document.appendOpen('[');
+    }
+    void onEndArray(std::size_t elementCount) override
+    {
+      m_Document.appendClose(']', m_Open.back(), elementCount);
+      m_Open.pop_back();
+    }
+    void onString(std::string_view str) override
+    {
+      m_Document.appendString(str);
+    }
+    void onInt64(int64_t value) override
+    {
+      m_Document.appendWord('l', 0);
+      m_Document.m_Tape.push_back((uint64_t)value);
+    }
+    void onUnsigned(uint64_t value) override
+    {
+      m_Document.appendWord('u', 0);
+      m_Document.m_Tape.push_back(value);
+    }
+    void onDouble(double value) override
+    {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      m_Document.appendWord('d', 0);
+      m_Document.m_Tape.push_back(bits);
+    }
+    void onBool(bool value) override
+    {
+      m_Document.appendWord(value ? 't' : 'f', 0);
+    }
+    void onNull() override
+    {
+      m_Document.appendWord('n', 0);
+    }
+
+  private:
+    TapeDocument& m_Document;
+    std::vector<std::size_t> m_Open; // opening words of the containers being parsed, innermost last
+  };
+
+  TapeDocument TapeDocument::Parse(std::string_view text, const ParseOptions& options)
+  {
+    TapeDocument document;
+    TapeBuilder builder(document);
+    EventParser(text, builder, true, options).parse();
+    // The size is not known up front, give back what geometric growth over-allocated.
+    if (document.m_Tape.capacity() - document.m_Tape.size() > document.m_Tape.size() / 4)
+      document.m_Tape.shrink_to_fit();
+    if (document.m_Strings.capacity() - document.m_Strings.size() > document.m_Strings.size() / 4)
+      document.m_Strings.shrink_to_fit();
+    return document;
+  }
+
+  TapeDocument TapeDocument::ParseFile(const std::string& path, const ParseOptions& options)
+  {
+    MappedFile file(path);
+    return Parse(file.getText(), options);
+  }
+
+  TapeRef TapeDocument::getRoot() const
+  {
+    if (m_Tape.empty())
+      throw std::runtime_error("Tape is empty.");
+    return TapeRef(m_Tape.data(), m_Strings.data(), 0);
+  }
+
+  std::size_t TapeDocument::getMemoryUsage() const
+  {
+    return m_Tape.capacity() * sizeof(uint64_t) + m_Strings.capacity();
+  }
+
+  void TapeDocument::appendWord(char tag, uint64_t payload)
+  {
+    m_Tape.push_back(((uint64_t)(unsigned char)tag << TagShift) | payload);
+  }
+
+  void TapeDocument::appendOpen(char tag)
+  {
+    appendWord(tag, 0); // patched by appendClose
+    m_Tape.push_back(0);
+  }
+
+  void TapeDocument::appendClose(char tag, std::size_t open, std::size_t length)
+  {
+    appendWord(tag, open);
+    m_Tape[open] |= m_Tape.size();
+    m_Tape[open + 1] = length;
+  }
+
+  void TapeDocument::appendString(std::string_view str)
+  {
+    if (str.size() > UINT32_MAX)
+      throw std::runtime_error("String is too long for a tape.");
+    appendWord('"', m_Strings.size());
+    uint32_t length = (uint32_t)str.size();
+    std::size_t offset = m_Strings.size();
+    m_Strings.resize(offset + sizeof(length) + str.size() + 1);
+    std::memcpy(&m_Strings[offset], &length, sizeof(length));
+    if (!str.empty())
+      std::memcpy(&m_Strings[offset + sizeof(length)], str.data(), str.size());
+    m_Strings.back() = '\0';
+  }
+
+  /**
+   * @brief Writes a json to the tape without recursing, the arrays and objects being written are kept on an explicit
+   * stack.
+   */
+  void TapeDocument::append(const Node& root)
+  {
+    struct Frame
+    {
+      const Node* node;
+      std::size_t next; // index of the next member or element to write
+      std::size_t open; // tape index of the opening word
+    };
+    std::vector<Frame> stack;
+
+    const Node* value = &root;
+    while (value != nullptr)
+    {
+      const Node& node = *value;
+      switch (node.type)
+      {
+      case NodeType::Object:
+      case NodeType::Array:
+        stack.push_back(Frame{&node, 0, m_Tape.size()});
+        appendOpen(node.type == NodeType::Object ? '{' : '[');
+        break;
+      case NodeType::Integer:
+        appendWord((node.flags & Node::UnsignedInteger) ? 'u' : 'l', 0);
+        m_Tape.push_back((uint64_t)node.data.integer);
+        break;
+      case NodeType::Double: {
+        uint64_t bits;
+        std::memcpy(&bits, &node.data.dbl, sizeof(bits));
+        appendWord('d', 0);
+        m_Tape.push_back(bits);
+        break;
+      }
+      case NodeType::Boolean:
+        appendWord(node.data.boolean ? 't' : 'f', 0);
+        break;
+      case NodeType::String:
+        appendString(node.getString());
+        break;
+      case NodeType::Null:
+      case NodeType::None:
+        appendWord('n', 0);
+        break;
+      }
+
+      value = nullptr;
+      while (value == nullptr && !stack.empty())
+      {
+        Frame& frame = stack.back();
+        const Node& container = *frame.node;
+        bool isObject = container.type == NodeType::Object;
+        std::size_t length = container.data.array.length; // same layout for objects
+        if (frame.next == length)
+        {
+          appendClose(isObject ? '}' : ']', frame.open, length);
+          stack.pop_back();
+          continue;
+        }
+        std::size_t i = frame.next++;
+        if (isObject)
+        {
+          appendString(container.data.object.values[i]->nameNode->getString());
+          value = container.data.object.values[i]->node;
+        }
+        else
+          value = container.data.array.values[i];
+      }
+    }
+  }
+
+  char TapeRef::getTag() const
+  {
+    return TagOf(m_Tape[m_Index]);
+  }
+
+  std::size_t TapeRef::skip(std::size_t index) const
+  {
+    switch (TagOf(m_Tape[index]))
+    {
+    case '{':
+    case '[':
+      return m_Tape[index] & PayloadMask;
+    case 'l':
+    case 'u':
+    case 'd':
+      return index + 2;
+    default:
+      return index + 1;
+    }
+  }
+
+  std::size_t TapeRef::child(std::size_t idx) const
+  {
+    char tag = getTag();
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node is not an array or an object.");
+    if (idx >= m_Tape[m_Index + 1])
+      throw std::runtime_error("Invalid element index.");
+    std::size_t index = m_Index + 2;
+    for (std::size_t i = 0; i < idx; i++)
+      index = tag == '{' ? skip(index + 1) : skip(index);
+    return index;
+  }
+
+  std::string_view TapeRef::stringAt(std::size_t index) const
+  {
+    const char* str = m_Strings + (m_Tape[index] & PayloadMask);
+    uint32_t length;
+    std::memcpy(&length, str, sizeof(length));
+    return std::string_view(str + sizeof(length), length);
+  }
+
+  NodeType TapeRef::getType() const
+  {
+    switch (getTag())
+    {
+    case '{':
+      return NodeType::Object;
+    case '[':
+      return NodeType::Array;
+    case '"':
+      return NodeType::String;
+    case 'l':
+    case 'u':
+      return NodeType::Integer;
+    case 'd':
+      return NodeType::Double;
+    case 't':
+    case 'f':
+      return NodeType::Boolean;
+    case 'n':
+      return NodeType::Null;
+    default:
+      return NodeType::None;
+    }
+  }
+
+  bool TapeRef::isUnsigned() const
+  {
+    return getTag() == 'u';
+  }
+
+  TapeRef::operator bool() const
+  {
+    char tag = getTag();
+    if (tag == 't' || tag == 'f')
+      return tag == 't';
+    throw std::runtime_error("Node is not a boolean.");
+  }
+
+  TapeRef::operator int64_t() const
+  {
+    switch (getTag())
+    {
+    case 'l':
+      return (int64_t)m_Tape[m_Index + 1];
+    case 'u':
+      throw std::runtime_error("Integer does not fit in int64_t.");
+    case 'd':
+      return (int64_t)(double)*this;
+    default:
+      throw std::runtime_error("Node is not a number.");
+    }
+  }
+
+  TapeRef::operator const char*() const
+  {
+    if (getTag() != '"')
+      throw std::runtime_error("Node is not a string.");
+    return stringAt(m_Index).data();
+  }
+
+  TapeRef::operator double() const
+  {
+    switch (getTag())
+    {
+    case 'l':
+      return (double)(int64_t)m_Tape[m_Index + 1];
+    case 'u':
+      return (double)m_Tape[m_Index + 1];
+    case 'd': {
+      double value;
+      std::memcpy(&value, &m_Tape[m_Index + 1], sizeof(value));
+      return value;
+    }
+    default:
+      throw std::runtime_error("Node is not a number.");
+    }
+  }
+
+  TapeRef TapeRef::operator[](std::size_t idx) const
+  {
+    std::size_t index = child(idx);
+    return TapeRef(m_Tape, m_Strings, getTag() == '{' ? index + 1 : index);
+  }
+
+  TapeRef TapeRef::operator[](std::string_view key) const
+  {
+    if (getTag() != '{')
+      throw std::runtime_error("Node is not an object.");
+    std::size_t length = m_Tape[m_Index + 1];
+    std::size_t index = m_Index + 2;
+    for (std::size_t i = 0; i < length; i++)
+    {
+      if (stringAt(index) == key)
+        return TapeRef(m_Tape, m_Strings, index + 1);
+      index = skip(index + 1);
+    }
+    throw std::runtime_error("Invalid member index (" + std::string(key) + ").");
+  }
+
+  std::string_view TapeRef::getKey(std::size_t idx) const
+  {
+    if (getTag() != '{')
+      throw std::runtime_error("Node is not an object.");
+    return stringAt(child(idx));
+  }
+
+  std::size_t TapeRef::getSize() const
+  {
+    switch (getTag())
+    {
+    case '{':
+    case '[':
+      return m_Tape[m_Index + 1];
+    case '"':
+      return stringAt(m_Index).size();
+    default:
+      throw std::runtime_error("Node does not have a size.");
+    }
+  }
+
+  std::string_view TapeRef::getString() const
+  {
+    if (getTag() != '"')
+      throw std::runtime_error("Node is not a string.");
+    return stringAt(m_Index);
+  }
+
+  TapeIterator TapeRef::begin() const
+  {
+    char tag = getTag();
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node is not an array or an object.");
+    return TapeIterator(*this, m_Index + 2, tag == '{');
+  }
+
+  TapeIterator TapeRef::end() const
+  {
+    char tag = getTag();
+    if (tag != '{' && tag != '[')
+      throw std::runtime_error("Node is not an array or an object.");
+    return TapeIterator(*this, (m_Tape[m_Index] & PayloadMask) - 1, tag == '{'); // the closing word
+  }
+
+  TapeRef TapeIterator::operator*() const
+  {
+    return TapeRef(m_Container.m_Tape, m_Container.m_Strings, m_IsObject ? m_Index + 1 : m_Index);
+  }
+
+  std::string_view TapeIterator::getKey() const
+  {
+    if (!m_IsObject)
+      throw std::runtime_error("Node is not an object.");
+    return m_Container.stringAt(m_Index);
+  }
+
+  TapeIterator& TapeIterator::operator++()
+  {
+    m_Index = m_Container.skip(m_IsObject ? m_Index + 1 : m_Index);
+    return *this;
+  }
+
+  uint64_t TapeRef::getUnsigned() const
+  {
+    char tag = getTag();
+    if (tag != 'l' && tag != 'u')
+      throw std::runtime_error("Node is not an integer.");
+    if (tag == 'l' && (int64_t)m_Tape[m_Index + 1] < 0)
+      throw std::runtime_error("Integer is negative.");
+    return m_Tape[m_Index + 1];
+  }
+
+} // namespace json
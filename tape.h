@@ -0,0 +1,262 @@
+#pragma once
+
+#include "handler.h"
+#include "json.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+  class TapeDocument;
+  class TapeIterator;
+
+  /**
+   * @brief A read-only cursor to a value inside a TapeDocument. It is a pair of pointers and an index, cheap to copy and
+   * valid as long as the document is alive. Moving the document does not invalidate it. The conversion operators are
+   * explicit so that indexing with string literals is not ambiguous.
+   */
+  class TapeRef
+  {
+  public:
+    /**
+     * @brief Returns the type of the value. Unsigned integers are reported as Integer, see isUnsigned().
+     *
+     * @return NodeType
+     */
+    NodeType getType() const;
+
+    /**
+     * @brief Returns true if the value is an integer above INT64_MAX, see ParseOptions::keepLargeIntegersUnsigned.
+     */
+    bool isUnsigned() const;
+
+    /**
+     * @brief Tries to cast the value to a boolean. Throws if type is not Boolean.
+     */
+    explicit operator bool() const;
+
+    /**
+     * @brief Tries to cast the value to an integer. Throws if type is not Number(Integer, Double).
+     */
+    explicit operator int64_t() const;
+
+    /**
+     * @brief Tries to cast the value to a null terminated const char*. Throws if the type is not String.
+     */
+    explicit operator const char*() const;
+
+    /**
+     * @brief Tries to cast the value to a double. Throws if the type is not a Number(Integer, Double).
+     */
+    explicit operator double() const;
+
+    /**
+     * @brief Returns the element at the specified index inside an array or the value of the member at that index inside
+     * an object. Throws if index is invalid. Elements are found by skipping over their predecessors, so this is linear in
+     * idx.
+     *
+     * @param idx Desired index.
+     * @return TapeRef
+     */
+    TapeRef operator[](std::size_t idx) const;
+
+    /**
+     * @brief Returns the value inside the object at the specified key. Throws if the key does not exist.
+     *
+     * @param key Desired key.
+     * @return TapeRef
+     */
+    TapeRef operator[](std::string_view key) const;
+
+    /**
+     * @brief Returns the key of the member at the specified index inside the object. Throws if index is invalid.
+     *
+     * @param idx Desired index.
+     * @return std::string_view
+     */
+    std::string_view getKey(std::size_t idx) const;
+
+    /**
+     * @brief Returns the size of array, object or string. If type is not an array, object or string throws.
+     *
+     * @return std::size_t
+     */
+    std::size_t getSize() const;
+
+    /**
+     * @brief Returns the characters of a string. Throws if the type is not String.
+     *
+     * @return std::string_view
+     */
+    std::string_view getString() const;
+
+    /**
+     * @brief Returns the value of a non-negative integer, including ones above INT64_MAX. Throws if the type is not
+     * Integer or the value is negative.
+     *
+     * @return uint64_t
+     */
+    uint64_t getUnsigned() const;
+
+    /**
+     * @brief Returns an iterator to the first element of an array or the first member of an object. Throws if the type
+     * is not Array or Object. Iterating visits the tape front to back.
+     *
+     * @return TapeIterator
+     */
+    TapeIterator begin() const;
+
+    /**
+     * @brief Returns the iterator one past the last element of an array or member of an object.
+     *
+     * @return TapeIterator
+     */
+    TapeIterator end() const;
+
+  private:
+    TapeRef(const uint64_t* tape, const char* strings, std::size_t index)
+      : m_Tape(tape), m_Strings(strings), m_Index(index)
+    {
+    }
+
+    char getTag() const;
+
+    /**
+     * @brief Returns the index of the value following the one at index.
+     */
+    std::size_t skip(std::size_t index) const;
+
+    /**
+     * @brief Returns the index of the idx-th value inside the container and throws if there is none. For objects the
+     * index of the key is returned.
+     */
+    std::size_t child(std::size_t idx) const;
+
+    std::string_view stringAt(std::size_t index) const;
+
+  private:
+    const uint64_t* m_Tape;
+    const char* m_Strings;
+    std::size_t m_Index;
+
+    friend class TapeDocument;
+    friend class TapeIterator;
+  };
+
+  /**
+   * @brief Forward iterator over the elements of an array or the members of an object of a TapeDocument.
+   */
+  class TapeIterator
+  {
+  public:
+    /**
+     * @brief Returns the current element, or the value of the current member.
+     */
+    TapeRef operator*() const;
+
+    /**
+     * @brief Returns the key of the current member. Only valid when iterating an object.
+     */
+    std::string_view getKey() const;
+
+    TapeIterator& operator++();
+
+    bool operator==(const TapeIterator& other) const
+    {
+      return m_Index == other.m_Index;
+    }
+    bool operator!=(const TapeIterator& other) const
+    {
+      return m_Index != other.m_Index;
+    }
+
+  private:
+    TapeIterator(const TapeRef& container, std::size_t index, bool isObject)
+      : m_Container(container), m_Index(index), m_IsObject(isObject)
+    {
+    }
+
+  private:
+    TapeRef m_Container;
+    std::size_t m_Index; // the key of objects, the element of arrays
+    bool m_IsObject;
+
+    friend class TapeRef;
+  };
+
+  /**
+   * @brief An immutable json stored as one contiguous tape of 64 bit words plus a buffer holding all the strings.
+   * Compared to the Node tree it needs a fraction of the memory and reading it walks memory front to back.
+   *
+   * Every word holds a tag character in its top byte and a payload in the lower 56 bits:
+   * - '{' and '[': the payload is the index one past the matching closing word, the following word is the element
+   *   count. Members of objects are stored as a key followed by the value.
+   * - '}' and ']': the payload is the index of the opening word.
+   * - '"': the payload is the offset of the string in the string buffer, where it is stored as a 32 bit length followed
+   *   by the characters and a null terminator.
+   * - 'l', 'u' and 'd': int64, uint64 and double. The value is stored in the following word.
+   * - 't', 'f' and 'n': true, false and null.
+   */
+  class TapeDocument
+  {
+  public:
+    TapeDocument() = default;
+
+    /**
+     * @brief Builds a tape holding a copy of a json tree.
+     *
+     * @param root The root of the json.
+     */
+    explicit TapeDocument(const Node& root);
+
+    /**
+     * @brief Parses a json straight into a tape. Throws an exception if the format is incorrect.
+     *
+     * @param text The text version of the json.
+     * @param options Options controlling how the json is parsed. Strings are always copied into the tape.
+     * @return TapeDocument
+     */
+    static TapeDocument Parse(std::string_view text, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Parses a json file straight into a tape. Throws an exception if the file cannot be read or the format is
+     * incorrect.
+     *
+     * @param path Path to the file.
+     * @param options Options controlling how the json is parsed. Strings are always copied into the tape.
+     * @return TapeDocument
+     */
+    static TapeDocument ParseFile(const std::string& path, const ParseOptions& options = ParseOptions());
+
+    /**
+     * @brief Returns a cursor to the root value. Throws if the document is empty.
+     *
+     * @return TapeRef
+     */
+    TapeRef getRoot() const;
+
+    /**
+     * @brief Returns the number of bytes used by the tape and the strings.
+     *
+     * @return std::size_t
+     */
+    std::size_t getMemoryUsage() const;
+
+  private:
+    void append(const Node& root);
+    void appendOpen(char tag);
+    void appendClose(char tag, std::size_t open, std::size_t length);
+    void appendWord(char tag, uint64_t payload);
+    void appendString(std::string_view str);
+
+  private:
+    std::vector<uint64_t> m_Tape;
+    std::vector<char> m_Strings;
+
+    friend class TapeBuilder;
+  };
+
+} // namespace json
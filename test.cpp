@@ -1,29 +1,108 @@
 #include "json.h"
+#include "pushparser.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
-int main(int argc, char** argv)
+/**
+ * @brief Parses a text with a PushParser fed in chunks of a size. Returns the compact value, or "error" if the text is
+ * not exactly one value.
+ */
+static std::string PushText(const std::string& text, std::size_t chunkSize)
 {
-  std::ifstream stream;
-  if (argc > 1)
-    stream = std::ifstream(argv[1]);
-  else
-    stream = std::ifstream("test.json");
+  try
+  {
+    json::PushParser parser;
+    for (std::size_t i = 0; i < text.size(); i += chunkSize)
+      parser.feed(text.data() + i, std::min(chunkSize, text.size() - i));
+    parser.finish();
+    json::Json result = parser.next();
+    json::Json extra = parser.next();
+    std::ostringstream output;
+    if (result != nullptr && extra == nullptr)
+      json::JsonParser::CompactPrint(result, output);
+    json::JsonParser::JsonFree(result);
+    json::JsonParser::JsonFree(extra);
+    return result != nullptr && extra == nullptr ? output.str() : "error";
+  }
+  catch (const std::exception& ex)
+  {
+    return "error";
+  }
+}
 
-  std::string str((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+/**
+ * @brief Parses a file with a PushParser fed one byte at a time and in a few other chunk sizes, so that every token is
+ * cut by the end of a chunk somewhere. The push parser has to build the same value as JsonParser::Parse, or reject the
+ * file if it does not validate, which is stricter than JsonParser::Parse. Prints the difference if it does not.
+ */
+static int ComparePushParser(const std::string& path)
+{
+  std::ifstream input(path, std::ios::binary);
+  std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
 
-  json::Node* result;
+  std::string parsed;
   try
   {
-    result = json::JsonParser::Parse(str);
+    json::Json result = json::JsonParser::Parse(text);
+    std::ostringstream output;
+    json::JsonParser::CompactPrint(result, output);
+    json::JsonParser::JsonFree(result);
+    parsed = output.str();
   }
   catch (const std::exception& ex)
   {
-    std::cerr << ex.what() << std::endl;
-    return 0;
+    parsed = "error";
   }
+
+  for (std::size_t chunkSize : {1, 2, 3, 5, 8})
+  {
+    std::string pushed = PushText(text, chunkSize);
+    if (parsed != pushed && !(pushed == "error" && !json::JsonParser::ValidateFile(path)))
+    {
+      std::cerr << "Parse: " << parsed << std::endl
+                << "Push parser in chunks of " << chunkSize << ": " << pushed << std::endl;
+      return 0;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  std::string path = argc > 1 ? argv[1] : "test.json";
+
+  if (argc > 2 && !std::strcmp(argv[2], "--push"))
+    return ComparePushParser(path);
+
   if (argc > 2 && !std::strcmp(argv[2], "--output"))
+  {
+    json::Node* result;
+    try
+    {
+      result = json::JsonParser::ParseFile(path);
+    }
+    catch (const std::exception& ex)
+    {
+      std::cerr << ex.what() << std::endl;
+      return 0;
+    }
     json::JsonParser::PrettyPrint(result);
+    return 0;
+  }
+
+  try
+  {
+    json::ValidationResult result = json::JsonParser::ValidateFile(path);
+    if (!result)
+      std::cerr << "Unexpected character at " << result.line << ":" << result.column << ". Expected \""
+                << result.expected << "\"." << std::endl;
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << ex.what() << std::endl;
+  }
   return 0;
 }
\ No newline at end of file
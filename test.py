@@ -17,7 +17,7 @@ class bcolors:
     UNDERLINE = '\033[4m'
 
 start = time.time()
-complete = subprocess.run('clang++ -Wno-switch -O2 json.cpp utils.cpp test.cpp parser.cpp -o parser', shell=True)
+complete = subprocess.run('clang++ -std=c++17 -Wno-switch -O2 -pthread arena.cpp binding.cpp eventparser.cpp editbatch.cpp json.cpp jsonlines.cpp keyindex.cpp keytable.cpp mappedfile.cpp numberparser.cpp ondemand.cpp parallelparser.cpp pointer.cpp pushparser.cpp stringscanner.cpp structural.cpp tape.cpp threadpool.cpp validator.cpp utils.cpp test.cpp parser.cpp -o parser', shell=True)
 if complete.stderr is not None:
    print('Compilation failed')
    exit(0)
@@ -53,7 +53,34 @@ print()
 print(bcolors.HEADER + "Ran %d tests in %f seconds" % (test_count, time.time() - start))
 
 start = time.time()
-complete = subprocess.run('clang++ -Wno-switch -O2 interpreter.cpp utils.cpp json.cpp testcmds.cpp parser.cpp -o testcmds', shell=True)
+push_count = 0
+for root, dirs, files in os.walk("tests"):
+    for name in files:
+        if not name.startswith('n_') and not name.startswith('y_'):
+            continue
+        push_count += 1
+        try:
+            complete = subprocess.check_output(['./parser', './tests/' + name, '--push'], stderr=subprocess.STDOUT, universal_newlines=True)
+            if not complete:
+                print(bcolors.OKGREEN + 'p', end='')
+            else:
+                fail(name)
+                if len(sys.argv) > 1 and sys.argv[1] == '--more':
+                    print(complete)
+        except:
+            fail(name)
+print()
+print(bcolors.HEADER + "Ran %d push parser tests in %f seconds" % (push_count, time.time() - start))
+
+complete = subprocess.run('echo \'{"a": [1, 2]} \' | ./parser /dev/stdin --output', shell=True, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT, universal_newlines=True)
+if complete.stdout.split() != ['{', '"a":', '[', '1,', '2', ']', '}']:
+    print(bcolors.FAIL + 'Parsing from a pipe failed.')
+else:
+    print(bcolors.OKGREEN + 'Parsing from a pipe works.')
+
+start = time.time()
+complete = subprocess.run('clang++ -std=c++17 -Wno-switch -O2 -pthread interpreter.cpp utils.cpp arena.cpp binding.cpp eventparser.cpp editbatch.cpp json.cpp jsonlines.cpp keyindex.cpp keytable.cpp mappedfile.cpp numberparser.cpp ondemand.cpp parallelparser.cpp pointer.cpp pushparser.cpp stringscanner.cpp structural.cpp tape.cpp threadpool.cpp validator.cpp testcmds.cpp parser.cpp -o testcmds', shell=True)
 if complete.stderr is not None:
    print('Compilation failed')
    exit(0)
@@ -63,6 +90,7 @@ try:
     output = subprocess.check_output('./testcmds', stderr=subprocess.STDOUT, shell=True, timeout=3, universal_newlines=True)
 except subprocess.CalledProcessError as exc:
     print(bcolors.FAIL + 'Testcmds execution could not complete. ' + str(exc))
+    print(exc.output)
 else:
     search_compact = open('tests/search.json', 'r').read()
     search_compact_correct = open('tests/search_compact_correct.json').read()
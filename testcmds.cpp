@@ -1,5 +1,929 @@
+#include "arena.h"
+#include "binding.h"
+#include "editbatch.h"
+#include "handler.h"
 #include "interpreter.h"
+#include "json.h"
+#include "jsonlines.h"
+#include "keytable.h"
+#include "keyindex.h"
+#include "ondemand.h"
+#include "pointer.h"
+#include "pushparser.h"
+#include "stringscanner.h"
+#include "tape.h"
+
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static int s_Failures = 0;
+
+static void Check(bool condition, const std::string& what)
+{
+  if (condition)
+    return;
+  std::cerr << "Check failed: " << what << std::endl;
+  s_Failures++;
+}
+
+static void Run(void (*test)(), const char* name)
+{
+  try
+  {
+    test();
+  }
+  catch (const std::exception& ex)
+  {
+    Check(false, std::string(name) + " threw " + ex.what());
+  }
+}
+
+static std::string Error(const std::function<void()>& action)
+{
+  try
+  {
+    action();
+  }
+  catch (const std::exception& ex)
+  {
+    return ex.what();
+  }
+  return "";
+}
+
+/**
+ * @brief Parses jsons from the callbacks of another parse on the same thread, which must not take over the token
+ * positions the outer parse is reading.
+ */
+static void TestNestedParse()
+{
+  struct NestedHandler : json::JsonHandler
+  {
+    std::string inner;
+    std::size_t values = 0;
+    std::size_t innerElements = 0;
+
+    void onInt64(int64_t /*value*/) override
+    {
+      values++;
+      json::Json parsed = json::JsonParser::Parse(inner);
+      innerElements += parsed->getSize();
+      json::JsonParser::JsonFree(parsed);
+    }
+  };
+
+  NestedHandler handler;
+  handler.inner = "[0";
+  for (int i = 1; i < 2000; i++)
+    handler.inner += "," + std::to_string(i);
+  handler.inner += "]";
+  json::JsonParser::Parse("[1, 2, 3, 4]", handler);
+  Check(handler.values == 4 && handler.innerElements == 8000, "parsing from a handler");
+}
+
+/**
+ * @brief Top level values given to a push parser have to be separated by whitespace.
+ */
+static void TestPushedValues()
+{
+  auto count = [](const std::string& text) {
+    json::PushParser parser;
+    for (char c : text)
+      parser.feed(&c, 1);
+    parser.finish();
+    int values = 0;
+    while (json::Json value = parser.next())
+    {
+      values++;
+      json::JsonParser::JsonFree(value);
+    }
+    return values;
+  };
+  for (const char* text : {"{}{}", "\"a\"\"b\"", "[1][2]", "{}1", "truefalse", "1\"a\""})
+  {
+    bool failed = false;
+    try
+    {
+      count(text);
+    }
+    catch (const std::exception& ex)
+    {
+      failed = true;
+    }
+    Check(failed, std::string("push parser rejects ") + text);
+  }
+  Check(count("1 2 {} [] \"a\"\n\"b\"\ttrue") == 7, "push parser reads values separated by whitespace");
+}
+
+/**
+ * @brief Returns the line and column of a parse error, "at line:column".
+ */
+static std::string ErrorPosition(const std::string& error)
+{
+  std::size_t at = error.find(" at ");
+  return at == std::string::npos ? error : error.substr(at + 1, error.find('.', at) - at - 1);
+}
+
+/**
+ * @brief A push parser has to report errors at the same line and column as JsonParser::Parse, which counts \n, \r\n and
+ * a lone \r as line breaks, wherever the chunks are cut.
+ */
+static void TestPushedLines()
+{
+  for (const char* text : {"[1,\r\n2,\r3,\n\r\n x]", "{\"a\":\r\r\n\r1 2}", "\r\n\r\n[1}", "\n\r\r\n[1,\r",
+                           "[\r\r\r\n\n\"a\"}", "[1,\r\n\r\n\r\n2\r x"})
+  {
+    std::string parsed = ErrorPosition(Error([&] { json::JsonParser::Parse(text); }));
+    for (std::size_t chunkSize : {1, 2, 3, 4})
+    {
+      std::string pushed = ErrorPosition(Error([&] {
+        std::string_view input(text);
+        json::PushParser parser;
+        for (std::size_t i = 0; i < input.size(); i += chunkSize)
+          parser.feed(input.data() + i, std::min(chunkSize, input.size() - i));
+        parser.finish();
+      }));
+      Check(!parsed.empty() && pushed == parsed,
+            "push parser reports " + pushed + " instead of " + parsed + " in chunks of " + std::to_string(chunkSize));
+    }
+  }
+}
+
+/**
+ * @brief Copies a json nested deeper than the stack could recurse into a tape.
+ */
+static void TestDeepTape()
+{
+  const std::size_t depth = 300000;
+  std::string text = std::string(depth, '[') + "{\"k\": [1, \"s\", 2.5, true, null]}" + std::string(depth, ']');
+  json::ParseOptions options;
+  options.maxDepth = 1000000;
+  json::Json root = json::JsonParser::Parse(text, options);
+  json::TapeDocument copied(*root);
+  json::JsonParser::JsonFree(root);
+  // 3 words per array and object, 1 per key, string and literal, 2 per number, the strings with length and terminator
+  Check(copied.getMemoryUsage() == (3 * depth + 14) * sizeof(uint64_t) + 2 * (sizeof(uint32_t) + 2),
+        "deep tape is measured exactly");
+
+  json::TapeRef value = copied.getRoot();
+  for (std::size_t i = 0; i < depth; i++)
+    value = value[0];
+  json::TapeRef member = value["k"];
+  Check(member.getSize() == 5 && member[1].getString() == "s" && (double)member[2] == 2.5,
+        "deep tape holds the innermost value");
+}
+
+/**
+ * @brief Writes a value of a tape with its types. Array elements are looked up by index, which skips over the ones
+ * before them by their closing words, and object members are iterated.
+ */
+static void DescribeTape(json::TapeRef value, std::string& out)
+{
+  switch (value.getType())
+  {
+  case json::NodeType::Object:
+    out += "{" + std::to_string(value.getSize());
+    for (json::TapeIterator it = value.begin(); it != value.end(); ++it)
+    {
+      out += " " + std::string(it.getKey()) + ":";
+      DescribeTape(*it, out);
+    }
+    out += "}";
+    break;
+  case json::NodeType::Array:
+    out += "[" + std::to_string(value.getSize());
+    for (std::size_t i = 0; i < value.getSize(); i++)
+    {
+      out += " ";
+      DescribeTape(value[i], out);
+    }
+    out += "]";
+    break;
+  case json::NodeType::String:
+    out += "s" + std::to_string(value.getSize()) + "'" + std::string(value.getString()) + "'";
+    break;
+  case json::NodeType::Integer:
+    out += value.isUnsigned() ? "u" + std::to_string(value.getUnsigned()) : "l" + std::to_string((int64_t)value);
+    break;
+  case json::NodeType::Double: {
+    std::ostringstream exact;
+    exact << std::hexfloat << (double)value;
+    out += "d" + exact.str();
+    break;
+  }
+  case json::NodeType::Boolean:
+    out += (bool)value ? "t" : "f";
+    break;
+  default:
+    out += "n";
+    break;
+  }
+}
+
+/**
+ * @brief Parses jsons straight into a tape and compares them with tapes copied from the parsed nodes.
+ */
+static void TestTapeParse()
+{
+  std::string large = "[";
+  for (int i = 0; i < 3000; i++)
+    large += (i > 0 ? "," : "") + std::string("{\"i\": ") + std::to_string(i) + ", \"s\": \"" +
+             std::string(i % 40, 'x') + "\", \"a\": [" + std::to_string(i * 0.25) + ", {}, []]}";
+  large += "]";
+  json::ParseOptions options;
+  options.keepLargeIntegersUnsigned = true;
+  for (const std::string& text :
+       {std::string("{\"a\": [1, -2, 2.5e-3, 18446744073709551615, 9223372036854775807, -9223372036854775808, 1e400],"
+                    " \"b\\\"\\u00e9\\n\": {\"c\": {}, \"d\": [], \"e\": [[[true]], false, null]}, \"\": \"\"}"),
+        std::string("[[], {}, [[]], [{}], \"x\"]"), std::string("  \"only\\ta string\" "), std::string("-0"),
+        large})
+  {
+    json::Json root = json::JsonParser::Parse(text, options);
+    json::TapeDocument copied(*root);
+    json::JsonParser::JsonFree(root);
+    json::TapeDocument parsed = json::TapeDocument::Parse(text, options);
+    std::string expected, got;
+    DescribeTape(copied.getRoot(), expected);
+    DescribeTape(parsed.getRoot(), got);
+    Check(got == expected, "tape parse matches the copy of " + text.substr(0, 60) + ", got " + got.substr(0, 200));
+    Check(parsed.getMemoryUsage() >= copied.getMemoryUsage() &&
+            parsed.getMemoryUsage() <= copied.getMemoryUsage() * 5 / 4 + sizeof(uint64_t),
+          "parsed tape gives back what it over-allocated for " + text.substr(0, 60));
+  }
+  Check(Error([] { json::TapeDocument::Parse("[1, {\"a\": 2]"); }).rfind("Unexpected character at ", 0) == 0,
+        "tape parse rejects mismatched brackets");
+}
+
+static std::string Compact(json::Json json)
+{
+  std::ostringstream output;
+  json::JsonParser::CompactPrint(json, output);
+  return output.str();
+}
+
+/**
+ * @brief Applies batches to a json in an arena and on the heap. A batch that fails, because a path is wrong, a json
+ * does not parse or two changes conflict, must leave the json as it was.
+ */
+static void TestEditBatch()
+{
+  for (bool heap : {false, true})
+  {
+    json::Json root = json::JsonParser::Parse("{\"a\":{\"x\":1,\"y\":[1,2]},\"b\":{\"z\":true},\"c\":3}");
+    if (heap)
+    {
+      json::Json copy = new json::Node(*root);
+      json::JsonParser::JsonFree(root);
+      root = copy;
+    }
+
+    json::EditBatch batch;
+    batch.edit("a/x", "2");
+    batch.create("a", "k1", "1");
+    batch.create("a", "k2", "[3]");
+    batch.create("d/e", "k3", "null");
+    batch.create("a", "k4", "4");
+    batch.remove("c");
+    batch.move("b", "a");
+    root->apply(batch);
+    std::string applied = Compact(root);
+    Check(applied == "{\"a\":{\"x\":2,\"y\":[1,2],\"k1\":1,\"k2\":[3],\"k4\":4,\"z\":true},\"b\":{},"
+                     "\"d\":{\"e\":{\"k3\":null}}}",
+          "batch makes its changes, creates in order");
+
+    auto rejects = [&](json::EditBatch& batch, const std::string& error) {
+      std::string what;
+      try
+      {
+        root->apply(batch);
+      }
+      catch (const std::exception& ex)
+      {
+        what = ex.what();
+      }
+      Check(what.rfind(error, 0) == 0, "batch fails with " + error + ", got " + what);
+      Check(Compact(root) == applied, "failed batch leaves the json unchanged: " + error);
+    };
+    json::EditBatch missing;
+    missing.edit("a/x", "5");
+    missing.edit("a/nope", "1");
+    rejects(missing, "Invalid member index (nope).");
+    json::EditBatch unparsable;
+    unparsable.edit("a/x", "5");
+    unparsable.create("a", "q", "{bad");
+    rejects(unparsable, "Unexpected character");
+    json::EditBatch removedParent;
+    removedParent.edit("a/x", "5");
+    removedParent.remove("a");
+    rejects(removedParent, "Conflicting changes to a.");
+    json::EditBatch twice;
+    twice.edit("a/x", "5");
+    twice.edit("a/x", "6");
+    rejects(twice, "Conflicting changes to a/x.");
+    json::EditBatch movedAway;
+    movedAway.create("a", "n", "1");
+    movedAway.move("a", "d");
+    rejects(movedAway, "Conflicting changes to a.");
+    json::EditBatch notObject;
+    notObject.create("a/x", "n", "1");
+    rejects(notObject, "Node is not an object.");
+    json::JsonParser::JsonFree(root);
+  }
+}
+
+/**
+ * @brief Parses pointers and looks them up.
+ */
+static void TestPointerSyntax()
+{
+  json::JsonPointer escaped("/a~1b/~0c/~01");
+  Check(escaped.size() == 3 && escaped.getKey(0) == "a/b" && escaped.getKey(1) == "~c" && escaped.getKey(2) == "~1",
+        "pointer unescapes ~1 and ~0");
+  Check(escaped.toString() == "/a~1b/~0c/~01", "pointer escapes its keys again");
+  Check(json::JsonPointer("").size() == 0, "empty pointer has no keys");
+  Check(json::JsonPointer("/").size() == 1 && json::JsonPointer("/").getKey(0).empty(), "/ is the empty key");
+  Check(json::JsonPointer("a/b").toString() == "/a/b", "leading slash is optional");
+  json::JsonPointer indices("/0/10/01/-/1a");
+  Check(indices.getIndex(0) == 0 && indices.getIndex(1) == 10, "digits are indices");
+  Check(indices.getIndex(2) == json::JsonPointer::NoIndex && indices.getIndex(3) == json::JsonPointer::NoIndex &&
+          indices.getIndex(4) == json::JsonPointer::NoIndex,
+        "leading zeros, - and letters are not indices");
+  Check(Error([] { json::JsonPointer("/a~2"); }) == "Invalid pointer (a~2).", "~ must be followed by 0 or 1");
+  Check(Error([] { json::JsonPointer("/a~"); }) == "Invalid pointer (a~).", "~ must not end the pointer");
+
+  json::Json root = json::JsonParser::Parse("{\"a/b\":{\"~c\":[10,{\"x\":5}]},\"\":7,\"01\":1}");
+  Check(&root->at(json::JsonPointer("")) == root, "empty pointer leads to the root");
+  Check(root->at(json::JsonPointer("/")).data.integer == 7, "empty key");
+  Check(root->at(json::JsonPointer("/a~1b/~0c/1/x")).data.integer == 5, "pointer through arrays and escapes");
+  Check(root->at(json::JsonPointer("/01")).data.integer == 1, "digits are keys of objects");
+  Check(Error([&] { root->at(json::JsonPointer("/a~1b/~0c/01")); }) == "Invalid element index.",
+        "leading zeros do not index arrays");
+  Check(Error([&] { root->at(json::JsonPointer("/a~1b/~0c/2")); }) == "Invalid element index.", "index past the end");
+  Check(Error([&] { root->at(json::JsonPointer("/nope")); }) == "Invalid member index (nope).", "missing key");
+  Check(Error([&] { root->at(json::JsonPointer("//x")); }) == "Node is not an object.", "path through a number");
+  json::JsonParser::JsonFree(root);
+}
+
+/**
+ * @brief A cached pointer has to look its node up again after every change to its json. Rewinding and adopting are
+ * checked by changing the json behind the back of the pointer, which only they can tell it about.
+ */
+static void TestPointerCache()
+{
+  json::Json root = json::JsonParser::Parse("{\"a\":{\"b\":1,\"c\":{\"d\":2}},\"e\":{},\"f\":[1,2]}");
+  json::JsonPointer b("/a/b", true), d("/a/c/d", true), moved("/e/b", true), element("/f/1", true);
+  Check(root->at(b).data.integer == 1 && &root->at(b) == &root->at(b), "cached pointer finds its node");
+
+  root->edit("a/b", "3");
+  Check(root->at(b).data.integer == 3, "edit invalidates the cache");
+  Check(Error([&] { root->at(moved); }) == "Invalid member index (b).", "moved member is not there yet");
+  root->move("a", "e");
+  Check(root->at(moved).data.integer == 3, "move invalidates the cache");
+  root->remove("e/b");
+  Check(Error([&] { root->at(moved); }) == "Invalid member index (b).", "remove invalidates the cache");
+  root->at(element);
+  json::EditBatch batch;
+  batch.edit("f", "[5,6]");
+  root->apply(batch);
+  Check(root->at(element).data.integer == 6, "apply invalidates the cache");
+  root->edit(json::JsonPointer("/f/1"), "7");
+  Check(root->at(element).data.integer == 7, "editing through a pointer invalidates the cache");
+
+  json::Arena* arena = json::Arena::Of(root);
+  json::JsonMember& f = *root->data.object.values[2];
+  json::Node* array = f.node;
+  f.node = root->data.object.values[1]->node; // f is e now, e holds c/d and not 1
+  Check(root->at(element).data.integer == 7, "unannounced changes are not seen");
+  arena->rewind(arena->mark());
+  Check(Error([&] { root->at(element); }) == "Invalid member index (1).", "rewind invalidates the cache");
+  f.node = array;
+  root->at(element);
+  json::Arena other;
+  other.allocate(16);
+  arena->adopt(other);
+  f.node = root->data.object.values[1]->node;
+  Check(Error([&] { root->at(element); }) == "Invalid member index (1).", "adopt invalidates the cache");
+  f.node = array;
+  json::JsonParser::JsonFree(root);
+
+  root = json::JsonParser::Parse("{\"a\":{\"c\":{\"d\":4}}}");
+  Check(root->at(d).data.integer == 4, "pointer is looked up again in another json");
+  json::JsonParser::JsonFree(root);
+}
+
+struct BoundItem
+{
+  uint64_t id = 0;
+  std::vector<bool> flags;
+};
+JSON_FIELDS(BoundItem, id, flags)
+
+struct BoundRecord
+{
+  std::string name;
+  int32_t count = 0;
+  float scale = 0;
+  double ratio = 0;
+  std::optional<std::string> note;
+  std::optional<BoundItem> main;
+  std::vector<BoundItem> items;
+};
+JSON_FIELDS(BoundRecord, name, count, scale, ratio, note, main, items)
+
+/**
+ * @brief Reads a registered struct from json text, checks the errors for values that do not fit its fields and writes
+ * it back.
+ */
+static void TestStructBinding()
+{
+  BoundRecord record = json::StructBinding::Parse<BoundRecord>(
+    "{\"unknown\": {\"a\": [1, \"]}\\\"\", {\"b\": null}], \"c\": {}}, \"na\\u006De\": \"x\\ty\", \"count\": -7,"
+    "\"scale\": 0.1, \"ratio\": 2.5e3, \"note\": null, \"main\": {\"id\": 18446744073709551615, \"flags\": []},"
+    "\"items\": [{\"flags\": [true, false, true], \"id\": 3}, {}], \"\\\"\": 1}");
+  Check(record.name == "x\ty" && record.count == -7 && record.scale == 0.1f && record.ratio == 2500 && !record.note,
+        "struct binding reads fields, escaped keys and skips unknown ones");
+  Check(record.main && record.main->id == UINT64_MAX && record.main->flags.empty(), "struct binding reads uint64_t");
+  Check(record.items.size() == 2 && record.items[0].id == 3 &&
+          record.items[0].flags == std::vector<bool>{true, false, true} && record.items[1].id == 0,
+        "struct binding reads vectors of structs and bools");
+
+  std::string written = json::StructBinding::Write(record);
+  Check(written == "{\"name\":\"x\\ty\",\"count\":-7,\"scale\":0.1,\"ratio\":2500,\"note\":null,"
+                   "\"main\":{\"id\":18446744073709551615,\"flags\":[]},"
+                   "\"items\":[{\"id\":3,\"flags\":[true,false,true]},{\"id\":0,\"flags\":[]}]}",
+        "struct binding writes compact json, got " + written);
+  record.note = "\"quoted\"";
+  BoundRecord read = json::StructBinding::Parse<BoundRecord>(json::StructBinding::Write(record));
+  Check(json::StructBinding::Write(read) == json::StructBinding::Write(record) && read.note == record.note,
+        "struct binding reads what it writes");
+
+  for (const char* text : {"{\"count\": 1.5}", "{\"count\": 1e2}", "{\"count\": 2147483648}",
+                           "{\"count\": -2147483649}", "{\"main\": {\"id\": -1}}",
+                           "{\"main\": {\"id\": 18446744073709551616}}", "{\"name\": \"a\"} x", "{} {}",
+                           "{\"items\": [{}, ]}", "{\"unknown\": [1 2]}", "{\"name\": 1}",
+                           "{\"main\": {\"flags\": [1]}}"})
+    Check(Error([&] { json::StructBinding::Parse<BoundRecord>(text); }).rfind("Unexpected character at ", 0) == 0,
+          std::string("struct binding rejects ") + text);
+  Check(json::StructBinding::Parse<BoundRecord>("{\"count\": -2147483648}").count == INT32_MIN,
+        "struct binding reads the smallest int32_t");
+}
+
+/**
+ * @brief Reads an on-demand document, skipping values with brackets and quotes inside their strings, and checks the
+ * errors of the parts that are read.
+ */
+static void TestOnDemand()
+{
+  std::string text = R"({"skipped": ["]", "\"}", {"x": "[{", "y": ['}']}], "a\"b": 1, "key": "v\nw",)"
+                     R"( "empty": {}, "none": [], "last": [true, 2.5]})";
+  json::OnDemandDocument document(text);
+  json::OnDemandRef root = document.getRoot();
+  Check((int64_t)root["a\"b"] == 1 && root["key"].getString() == "v\nw", "on-demand skips strings with brackets");
+  Check(root["skipped"].getSize() == 3 && root["skipped"][2]["y"][0].getString() == "}",
+        "on-demand reads inside skipped values");
+  Check(root.getKey(1) == "a\"b" && root.getKey(2) == "key", "on-demand decodes escaped keys");
+  Check(root["empty"].getSize() == 0 && root["empty"].begin() == root["empty"].end() && root["none"].getSize() == 0 &&
+          root["none"].begin() == root["none"].end(),
+        "on-demand empty containers");
+  Check((bool)root["last"][0] && (double)root["last"][1] == 2.5, "on-demand reads the last member");
+
+  std::vector<std::string> keys;
+  const char* decoded = nullptr;
+  for (int pass = 0; pass < 3; pass++)
+  {
+    keys.clear();
+    for (json::OnDemandIterator it = root.begin(); it != root.end(); ++it)
+    {
+      keys.emplace_back(it.getKey());
+      if (keys.back() == "a\"b" && pass == 0)
+        decoded = it.getKey().data();
+    }
+    Check(root.getKey(1).data() == decoded && root["key"].getString().data() == root["key"].getString().data(),
+          "on-demand decodes a string once");
+  }
+  Check(keys == std::vector<std::string>{"skipped", "a\"b", "key", "empty", "none", "last"}, "on-demand iterates keys");
+
+  auto rejects = [](const std::string& text, const std::function<void(json::OnDemandRef)>& read) {
+    json::OnDemandDocument document(text);
+    Check(Error([&] { read(document.getRoot()); }).rfind("Unexpected character at ", 0) == 0,
+          "on-demand rejects " + text);
+  };
+  rejects(R"({"a" 1})", [](json::OnDemandRef root) { root["a"]; });
+  rejects(R"({"a": 1 "b": 2})", [](json::OnDemandRef root) { root["b"]; });
+  rejects(R"([1 2])", [](json::OnDemandRef root) { root.getSize(); });
+  rejects(R"([1, 2)", [](json::OnDemandRef root) { root[2]; });
+  rejects(R"({"a": [1, "]")", [](json::OnDemandRef root) { root["b"]; });
+  rejects(R"({"a": 1,)", [](json::OnDemandRef root) { root.getSize(); });
+  rejects(R"(["a\q"])", [](json::OnDemandRef root) { root[0].getString(); });
+}
+
+/**
+ * @brief Parses an array big enough to be split between threads and compares it with a parse on one thread.
+ */
+static void TestParallelParse()
+{
+  std::string text = "[";
+  for (int i = 0; text.size() < 1536 * 1024; i++)
+    text += (i > 0 ? ",\n" : "") + std::string("{\"id\": ") + std::to_string(i) + ", \"name\": \"item " +
+            std::to_string(i) + "\\n\", \"tags\": [\"a\", 1.5, true, null], \"nested\": {\"id\": -1}}";
+  text += "]";
+
+  json::Json single = json::JsonParser::Parse(text);
+  json::Json parallel = json::JsonParser::ParseParallel(text, 4);
+  Check(Compact(parallel) == Compact(single), "parallel parse builds the same json");
+  const json::Node* id = json::Arena::Of(parallel)->findKeys()->find("id");
+  std::size_t length = parallel->data.array.length;
+  json::Node** elements = parallel->data.array.values;
+  Check(length > 1000 && id != nullptr && elements[0]->data.object.values[0]->nameNode == id &&
+          elements[length / 2]->data.object.values[0]->nameNode == id &&
+          elements[length - 1]->data.object.values[3]->node->data.object.values[0]->nameNode == id,
+        "keys parsed on different threads are shared");
+  Check(parallel->find("id").size() == 2 * length, "shared keys are found by pointer");
+  json::JsonParser::JsonFree(single);
+  json::JsonParser::JsonFree(parallel);
+
+  std::size_t corrupt = text.find("\"id\": ", text.size() * 2 / 3);
+  text[corrupt + 5] = ':';
+  std::string expected = Error([&] { json::JsonParser::Parse(text); });
+  Check(!expected.empty() && Error([&] { json::JsonParser::ParseParallel(text, 4); }) == expected,
+        "parallel parse gives the error of a parse on one thread");
+}
+
+/**
+ * @brief Parses newline delimited json spread over several batches, with blank lines and a line that does not parse.
+ */
+static void TestJsonLines()
+{
+  std::string text;
+  std::vector<std::size_t> lines; // line of every record, the bad one included
+  std::size_t line = 1, bad = 0;
+  for (int i = 0; text.size() < 1024 * 1024; i++, line++)
+  {
+    if (i % 7 == 3)
+      text += i % 2 == 0 ? "\n" : " \t \n"; // blank lines are counted but are not records
+    else if (i == 20000)
+    {
+      bad = lines.size();
+      lines.push_back(line);
+      text += "{\"n\" " + std::to_string(i) + "}\n";
+    }
+    else
+    {
+      lines.push_back(line);
+      text += "{\"n\": " + std::to_string(i) + ", \"text\": \"line " + std::to_string(line) + "\"}\n";
+    }
+  }
+
+  auto matches = [&](const json::JsonRecord& record, std::size_t i) {
+    if (record.line != lines[i])
+      return false;
+    if (i == bad)
+      return record.value == nullptr && record.error.rfind("Unexpected character at 1:", 0) == 0;
+    return record.value != nullptr &&
+           (*record.value)[std::string("text")].getString() == "line " + std::to_string(lines[i]);
+  };
+  json::JsonLines records = json::JsonLines::Parse(text, 4);
+  bool ordered = records.getSize() == lines.size();
+  for (std::size_t i = 0; ordered && i < lines.size(); i++)
+    ordered = matches(records[i], i);
+  Check(bad > 0 && ordered, "json lines keeps records and line numbers in order");
+
+  std::size_t seen = 0;
+  ordered = true;
+  auto next = [&](const json::JsonRecord& record) {
+    ordered = ordered && seen < lines.size() && matches(record, seen);
+    seen++;
+  };
+  json::JsonLines::Parse(text, next, 4);
+  Check(ordered && seen == lines.size(), "json lines hands the records to the callback in order");
+}
+
+static const char* const s_Keys[] = {"a", "b", "c", "d"};
+
+static std::string RandomJson(std::mt19937& random, int depth)
+{
+  unsigned kind = random() % 5;
+  if (depth > 2 || kind < 2)
+    return std::to_string(random() % 10);
+  std::string text = kind == 2 ? "[" : "{";
+  unsigned count = random() % 4;
+  for (unsigned i = 0; i < count; i++)
+  {
+    if (i > 0)
+      text += ",";
+    if (kind != 2)
+      text += std::string("\"") + s_Keys[random() % 4] + "\":";
+    text += RandomJson(random, depth + 1);
+  }
+  return text + (kind == 2 ? "]" : "}");
+}
+
+/**
+ * @brief Picks the path of a random member, going at most maxDepth objects deep. Returns false if the root has none.
+ */
+static bool RandomPath(std::mt19937& random, const json::Node& root, std::string& path, int maxDepth)
+{
+  path.clear();
+  const json::Node* node = &root;
+  for (int depth = 0; depth < maxDepth; depth++)
+  {
+    if (node->type != json::NodeType::Object || node->data.object.length == 0)
+      break;
+    const json::JsonMember& member = *node->data.object.values[random() % node->data.object.length];
+    if (!path.empty())
+      path += "/";
+    path += member.nameNode->getString();
+    node = &(*node)[std::string(member.nameNode->getString())];
+    if (random() % 3 == 0)
+      break;
+  }
+  return !path.empty();
+}
+
+/**
+ * @brief Makes random changes to jsons and checks after each of them that their key index finds the same members as a
+ * walk over the json, for documents in an arena and on the heap.
+ */
+static void TestKeyIndex()
+{
+  std::mt19937 random(7);
+  for (int round = 0; round < 200; round++)
+  {
+    std::string text = "{\"a\":" + RandomJson(random, 0) + ",\"b\":" + RandomJson(random, 0) + ",\"c\":{\"d\":" +
+                       RandomJson(random, 0) + "}}";
+    json::Json root = json::JsonParser::Parse(text);
+    if (round % 2 == 1)
+    {
+      json::Json copy = new json::Node(*root);
+      json::JsonParser::JsonFree(root);
+      root = copy;
+    }
+    json::KeyIndex index(*root);
+    for (int step = 0; step < 30; step++)
+    {
+      std::string path, to;
+      try
+      {
+        switch (random() % 4)
+        {
+        case 0:
+          if (RandomPath(random, *root, path, 3))
+            root->edit(path, RandomJson(random, 1), true, &index);
+          break;
+        case 1:
+          if (!RandomPath(random, *root, path, 3))
+            path = "a";
+          root->create(path, s_Keys[random() % 4], RandomJson(random, 1), true, &index);
+          break;
+        case 2:
+          if (RandomPath(random, *root, path, 3))
+            root->remove(path, &index);
+          break;
+        case 3:
+          if (RandomPath(random, *root, path, 2) && RandomPath(random, *root, to, 2))
+            root->move(path, to, &index);
+          break;
+        }
+      }
+      catch (const std::exception& ex)
+      {
+        // changes that do not fit the json are expected, the index must not have changed either
+      }
+      for (const char* key : s_Keys)
+      {
+        std::vector<json::MemberRef> walked = root->find(key);
+        const std::vector<json::MemberRef>& indexed = index.find(key);
+        bool same = walked.size() == indexed.size();
+        for (std::size_t i = 0; same && i < walked.size(); i++)
+          same = walked[i].object == indexed[i].object && walked[i].index == indexed[i].index;
+        Check(same, "key index finds the members of " + std::string(key) + " after changing " + path);
+      }
+    }
+    json::JsonParser::JsonFree(root);
+  }
+}
+
+/**
+ * @brief Searches jsons on several threads and checks that the same members are found in the same order as by find.
+ * Small random jsons split into ranges of single members, a large one into runs of many elements on every thread.
+ */
+static void TestFindParallel()
+{
+  std::mt19937 random(11);
+  std::vector<std::string> texts;
+  for (int i = 0; i < 100; i++)
+    texts.push_back("{\"a\":" + RandomJson(random, 0) + ",\"b\":{\"c\":" + RandomJson(random, 0) + "}}");
+  std::string large = "{\"a\": {\"b\": [";
+  for (int i = 0; i < 20000; i++)
+    large += (i > 0 ? "," : "") + RandomJson(random, 0);
+  large += "]}, \"c\": {\"d\": {\"a\": 1}}, \"a\": [{\"a\": {\"b\": 2}}]}";
+  texts.push_back(large);
+
+  for (std::size_t t = 0; t < texts.size(); t++)
+  {
+    json::Json root = json::JsonParser::Parse(texts[t]);
+    if (t % 2 == 1)
+    {
+      json::Json copy = new json::Node(*root);
+      json::JsonParser::JsonFree(root);
+      root = copy;
+    }
+    for (const char* key : s_Keys)
+    {
+      std::vector<json::MemberRef> walked = root->find(key);
+      for (unsigned threads : {2u, 4u, 7u})
+      {
+        std::vector<json::MemberRef> parallel = root->findParallel(key, threads);
+        bool same = walked.size() == parallel.size();
+        for (std::size_t i = 0; same && i < walked.size(); i++)
+          same = walked[i].object == parallel[i].object && walked[i].index == parallel[i].index;
+        Check(same, "parallel search for " + std::string(key) + " on " + std::to_string(threads) + " threads in " +
+                      texts[t].substr(0, 60));
+      }
+    }
+    Check(t + 1 < texts.size() || root->find("a").size() > 5000, "large json has many hits");
+    json::JsonParser::JsonFree(root);
+  }
+}
+
+/**
+ * @brief Changes an object with repeated keys so that it goes back and forth over the size from which its members are
+ * looked up in a hash index, and checks every lookup against a scan of the members.
+ */
+static void TestMemberIndex()
+{
+  std::mt19937 random(5);
+  const int keyCount = 12; // fewer keys than members, so that an indexed object repeats some
+  for (bool heap : {false, true})
+  {
+    std::string text = "{\"o\":{";
+    for (int i = 0; i < 14; i++)
+      text += (i > 0 ? ",\"k" : "\"k") + std::to_string(i % keyCount) + "\":" + std::to_string(i);
+    json::Json root = json::JsonParser::Parse(text + "},\"p\":{}}");
+    if (heap)
+    {
+      json::Json copy = new json::Node(*root);
+      json::JsonParser::JsonFree(root);
+      root = copy;
+    }
+
+    int value = 100;
+    bool indexed = false, repeated = false;
+    for (int step = 0; step < 400; step++)
+    {
+      std::string key = "k" + std::to_string(random() % keyCount);
+      std::string change;
+      switch (random() % 8)
+      {
+      case 0:
+      case 1:
+      case 2:
+        change = "remove " + key;
+        if (Error([&] { root->remove("o/" + key); }) == "Invalid member index (" + key + ").")
+          change = "remove missing " + key;
+        break;
+      case 3:
+        change = "edit " + key;
+        if ((*root)[std::string("o")].data.object.length > 0)
+          root->edit("o/" + std::string((*root)[std::string("o")].data.object.values[0]->nameNode->getString()),
+                     std::to_string(value++));
+        break;
+      case 4:
+        change = "move";
+        root->create("p", key, std::to_string(value++));
+        root->create("p", key, std::to_string(value++));
+        root->move("p", "o");
+        break;
+      default:
+        change = "create " + key;
+        root->create("o", key, std::to_string(value++));
+        break;
+      }
+
+      const json::Node& object = (*root)[std::string("o")];
+      std::size_t length = object.data.object.length;
+      indexed = indexed || length >= json::Node::IndexedObjectSize;
+      Check((object.data.object.index != nullptr) == (length >= json::Node::IndexedObjectSize),
+            "object has an index from 16 members on, after " + change);
+      for (int k = 0; k < keyCount; k++)
+      {
+        std::string name = "k" + std::to_string(k);
+        std::size_t first = length, count = 0;
+        for (std::size_t i = 0; i < length; i++)
+        {
+          if (object.data.object.values[i]->nameNode->getString() == name)
+          {
+            first = std::min(first, i);
+            count++;
+          }
+        }
+        repeated = repeated || (count > 1 && length >= json::Node::IndexedObjectSize);
+        if (first == length)
+          Check(!Error([&] { object[name]; }).empty(), "missing " + name + " is not found after " + change);
+        else
+          Check(&object[name] == object.data.object.values[first]->node,
+                "first member with " + name + " is found after " + change);
+      }
+      if (change.rfind("edit", 0) == 0 && length > 0)
+      {
+        std::string_view name = object.data.object.values[0]->nameNode->getString();
+        bool all = true;
+        for (std::size_t i = 0; i < length; i++)
+          if (object.data.object.values[i]->nameNode->getString() == name)
+            all = all && object.data.object.values[i]->node->data.integer == value - 1;
+        Check(all, "edit changes every member with the key");
+      }
+    }
+    Check(indexed && repeated, "objects were indexed with repeated keys");
+    json::JsonParser::JsonFree(root);
+  }
+}
+
+/**
+ * @brief Returns a string of that length whose characters have to be escaped at both ends when long enough.
+ */
+static std::string BoundaryString(std::size_t length, bool escaped)
+{
+  std::string str(length, 'a');
+  for (std::size_t i = 0; i < length; i++)
+    str[i] = (char)('a' + i % 26);
+  if (escaped && length >= 3)
+  {
+    str[0] = '\n';
+    str[length / 2] = '\\';
+    str[length - 1] = '"';
+  }
+  return str;
+}
+
+static bool IsInline(const json::Node& node, std::string_view str)
+{
+  const char* begin = (const char*)&node;
+  return (node.flags & json::Node::InlineString) && str.data() >= begin && str.data() < begin + sizeof(json::Node);
+}
+
+/**
+ * @brief Checks strings and keys around the longest length stored inside the node, parsed, copied to the heap, edited
+ * and printed, with and without characters that have to be escaped.
+ */
+static void TestInlineStrings()
+{
+  const std::size_t lengths[] = {0, 21, 22, 23, 24};
+  for (bool escaped : {false, true})
+  {
+    for (std::size_t l = 0; l < std::size(lengths); l++)
+    {
+      std::string str = BoundaryString(lengths[l], escaped);
+      std::string edited = BoundaryString(lengths[(l + 2) % std::size(lengths)], escaped);
+      std::ostringstream quotedStream, editedStream;
+      json::StringScanner::WriteQuoted(quotedStream, str);
+      json::StringScanner::WriteQuoted(editedStream, edited);
+      std::string quoted = quotedStream.str(), quotedEdit = editedStream.str();
+      std::string what = std::to_string(str.size()) + (escaped ? " escaped" : "") + " characters";
+
+      std::string text = "{" + quoted + ":1,\"s\":" + quoted + ",\"k\":[" + quoted + "]}";
+      json::Json root = json::JsonParser::Parse(text);
+      json::Json copy = new json::Node(*root);
+      for (json::Json json : {root, copy})
+      {
+        std::string where = std::string(json == copy ? " on the heap" : " in an arena");
+        const json::Node& key = *json->data.object.values[0]->nameNode;
+        const json::Node& value = *json->data.object.values[1]->node;
+        const json::Node& element = *json->data.object.values[2]->node->data.array.values[0];
+        Check(key.getString() == str && value.getString() == str && value.getSize() == str.size() &&
+                element.getString() == str,
+              "string of " + what + where);
+        bool fits = str.size() <= json::Node::InlineCapacity;
+        Check(IsInline(key, key.getString()) == fits && IsInline(value, value.getString()) == fits,
+              "string of " + what + " is inline up to the capacity" + where);
+        Check(Compact(json) == text, "compact print escapes " + what + where);
+        std::ostringstream pretty;
+        json::JsonParser::PrettyPrint(json, pretty);
+        Check(pretty.str().find(quoted + ": 1") != std::string::npos &&
+                pretty.str().find("\"s\": " + quoted) != std::string::npos,
+              "pretty print escapes " + what + where);
+
+        json->edit("s", quotedEdit);
+        json->edit(json::JsonPointer("/k/0"), quotedEdit);
+        const json::Node& changed = *json->data.object.values[1]->node;
+        const json::Node& changedElement = *json->data.object.values[2]->node->data.array.values[0];
+        Check(changed.getString() == edited && changed.getSize() == edited.size() &&
+                changedElement.getString() == edited &&
+                IsInline(changed, changed.getString()) == (edited.size() <= json::Node::InlineCapacity),
+              "edited string of " + what + " to " + std::to_string(edited.size()) + where);
+        Check(Compact(json) == "{" + quoted + ":1,\"s\":" + quotedEdit + ",\"k\":[" + quotedEdit + "]}",
+              "compact print of edited " + what + where);
+      }
+      json::JsonParser::JsonFree(root);
+      json::JsonParser::JsonFree(copy);
+    }
+  }
+}
 
 int main()
 {
@@ -30,4 +954,22 @@ int main()
       std::cerr << ex.what() << std::endl;
     }
   }
-}
\ No newline at end of file
+
+  Run(TestNestedParse, "TestNestedParse");
+  Run(TestPushedValues, "TestPushedValues");
+  Run(TestPushedLines, "TestPushedLines");
+  Run(TestDeepTape, "TestDeepTape");
+  Run(TestTapeParse, "TestTapeParse");
+  Run(TestKeyIndex, "TestKeyIndex");
+  Run(TestFindParallel, "TestFindParallel");
+  Run(TestMemberIndex, "TestMemberIndex");
+  Run(TestInlineStrings, "TestInlineStrings");
+  Run(TestEditBatch, "TestEditBatch");
+  Run(TestPointerSyntax, "TestPointerSyntax");
+  Run(TestPointerCache, "TestPointerCache");
+  Run(TestStructBinding, "TestStructBinding");
+  Run(TestOnDemand, "TestOnDemand");
+  Run(TestParallelParse, "TestParallelParse");
+  Run(TestJsonLines, "TestJsonLines");
+  return s_Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include "threadpool.h"
+
+namespace json
+{
+  ThreadPool::ThreadPool(unsigned threadCount)
+  {
+    if (threadCount == 0)
+      threadCount = DefaultThreadCount();
+    m_Workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+      m_Workers.emplace_back(&ThreadPool::work, this);
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Stopping = true;
+    }
+    m_Available.notify_all();
+    for (std::thread& worker : m_Workers)
+      worker.join();
+  }
+
+  std::future<void> ThreadPool::submit(std::function<void()> task)
+  {
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> result = packaged.get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Tasks.push_back(std::move(packaged));
+    }
+    m_Available.notify_one();
+    return result;
+  }
+
+  unsigned ThreadPool::DefaultThreadCount()
+  {
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+  }
+
+  void ThreadPool::work()
+  {
+    while (true)
+    {
+      std::packaged_task<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Available.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+        if (m_Tasks.empty())
+          return; // stopping and nothing left to do
+        task = std::move(m_Tasks.front());
+        m_Tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+} // namespace json
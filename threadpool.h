@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace json
+{
+  /**
+   * @brief A fixed set of worker threads running tasks in submission order.
+   */
+  class ThreadPool
+  {
+  public:
+    /**
+     * @brief Starts the workers.
+     *
+     * @param threadCount Number of workers, 0 uses one per hardware thread.
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /**
+     * @brief Finishes the tasks that were already submitted and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    /**
+     * @brief Queues a task. Exceptions thrown by the task are rethrown by the get() of the returned future.
+     *
+     * @param task The task.
+     * @return std::future<void>
+     */
+    std::future<void> submit(std::function<void()> task);
+
+    unsigned getThreadCount() const
+    {
+      return (unsigned)m_Workers.size();
+    }
+
+    /**
+     * @brief Returns the number of workers to use when 0 is asked for.
+     */
+    static unsigned DefaultThreadCount();
+
+  private:
+    void work();
+
+  private:
+    std::vector<std::thread> m_Workers;
+    std::deque<std::packaged_task<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Available;
+    bool m_Stopping = false;
+  };
+
+} // namespace json
@@ -0,0 +1,229 @@
+#include "validator.h"
+#include "lexer.h"
+#include "stringscanner.h"
+
+#include <cstring>
+
+namespace json
+{
+  static bool IsDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  static bool IsHexDigit(char c)
+  {
+    return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  }
+
+  Validator::Validator(std::string_view text)
+    : m_Begin(text.data()), m_End(text.data() + text.size()), m_Pos(text.data())
+  {
+  }
+
+  ValidationResult Validator::validate()
+  {
+    validateJson();
+    return m_Result;
+  }
+
+  bool Validator::validateJson()
+  {
+    static constexpr const char* Value = "object/array/string/true/false/number/null";
+    std::size_t depth = 0;
+    skipWhitespace();
+    while (true)
+    {
+      // A value is expected at m_Pos.
+      if (m_Pos == m_End)
+        return fail(m_Pos, Value);
+      switch (*m_Pos)
+      {
+      case '{':
+      case '[': {
+        bool isObject = *m_Pos == '{';
+        m_Pos++;
+        skipWhitespace();
+        if (m_Pos < m_End && *m_Pos == (isObject ? '}' : ']'))
+        {
+          m_Pos++;
+          break;
+        }
+        if (depth == MaxDepth)
+          return fail(m_Pos - 1, "shallower nesting");
+        m_IsObject[depth++] = isObject;
+        if (!isObject)
+          continue;
+        if (m_Pos == m_End || *m_Pos != '"')
+          return fail(m_Pos, "\"");
+        if (!validateString())
+          return false;
+        skipWhitespace();
+        if (m_Pos == m_End || *m_Pos != ':')
+          return fail(m_Pos, ":");
+        m_Pos++;
+        skipWhitespace();
+        continue;
+      }
+      case '"':
+        if (!validateString())
+          return false;
+        break;
+      case 't':
+        if (!validateLiteral("true", 4))
+          return false;
+        break;
+      case 'f':
+        if (!validateLiteral("false", 5))
+          return false;
+        break;
+      case 'n':
+        if (!validateLiteral("null", 4))
+          return false;
+        break;
+      default:
+        if (!validateNumber())
+          return false;
+        break;
+      }
+
+      // A value has ended, close every container that ends with it.
+      while (true)
+      {
+        skipWhitespace();
+        if (depth == 0)
+        {
+          if (m_Pos != m_End)
+            return fail(m_Pos, "EOF");
+          return true;
+        }
+        bool isObject = m_IsObject[depth - 1];
+        if (m_Pos < m_End && *m_Pos == (isObject ? '}' : ']'))
+        {
+          m_Pos++;
+          depth--;
+          continue;
+        }
+        if (m_Pos == m_End || *m_Pos != ',')
+          return fail(m_Pos, isObject ? ",/}" : ",/]");
+        m_Pos++;
+        skipWhitespace();
+        if (isObject)
+        {
+          if (m_Pos == m_End || *m_Pos != '"')
+            return fail(m_Pos, "\"");
+          if (!validateString())
+            return false;
+          skipWhitespace();
+          if (m_Pos == m_End || *m_Pos != ':')
+            return fail(m_Pos, ":");
+          m_Pos++;
+          skipWhitespace();
+        }
+        break;
+      }
+    }
+  }
+
+  bool Validator::validateString()
+  {
+    const char* pos = m_Pos + 1; // "
+    while (true)
+    {
+      std::size_t run = StringScanner::FindSpecial(pos, m_End, '"');
+      std::size_t valid = StringScanner::FindInvalidUtf8(pos, pos + run);
+      if (valid != run)
+        return fail(pos + valid, "UTF-8");
+      pos += run;
+      if (pos == m_End)
+        return fail(pos, "\"");
+      if (*pos == '"')
+        break;
+      if (*pos != '\\')
+        return fail(pos, "string character");
+      if (m_End - pos < 2)
+        return fail(pos + 1, "escape sequence");
+      switch (pos[1])
+      {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        pos += 2;
+        break;
+      case 'u':
+        if (m_End - pos < 6 || !IsHexDigit(pos[2]) || !IsHexDigit(pos[3]) || !IsHexDigit(pos[4]) ||
+            !IsHexDigit(pos[5]))
+          return fail(pos, "escape sequence");
+        pos += 6;
+        break;
+      default:
+        return fail(pos, "escape sequence");
+      }
+    }
+    m_Pos = pos + 1;
+    return true;
+  }
+
+  bool Validator::validateNumber()
+  {
+    const char* pos = m_Pos;
+    if (pos < m_End && *pos == '-')
+      pos++;
+    if (pos == m_End || !IsDigit(*pos))
+      return fail(pos, pos == m_Pos ? "object/array/string/true/false/number/null" : "digit");
+    if (*pos++ != '0')
+      while (pos < m_End && IsDigit(*pos))
+        pos++;
+    if (pos < m_End && *pos == '.')
+    {
+      pos++;
+      if (pos == m_End || !IsDigit(*pos))
+        return fail(pos, "digit");
+      while (pos < m_End && IsDigit(*pos))
+        pos++;
+    }
+    if (pos < m_End && (*pos == 'e' || *pos == 'E'))
+    {
+      pos++;
+      if (pos < m_End && (*pos == '+' || *pos == '-'))
+        pos++;
+      if (pos == m_End || !IsDigit(*pos))
+        return fail(pos, "digit");
+      while (pos < m_End && IsDigit(*pos))
+        pos++;
+    }
+    m_Pos = pos;
+    return true;
+  }
+
+  bool Validator::validateLiteral(const char* literal, std::size_t length)
+  {
+    if ((std::size_t)(m_End - m_Pos) < length || std::memcmp(m_Pos, literal, length) != 0)
+      return fail(m_Pos, literal);
+    m_Pos += length;
+    return true;
+  }
+
+  void Validator::skipWhitespace()
+  {
+    while (m_Pos < m_End && Lexer::IsWhitespace(*m_Pos))
+      m_Pos++;
+  }
+
+  bool Validator::fail(const char* position, const char* expected)
+  {
+    // The position is only needed once, so lines are counted here instead of while scanning.
+    m_Result.valid = false;
+    m_Result.offset = position - m_Begin;
+    m_Result.expected = expected;
+    std::string_view text(m_Begin, m_End - m_Begin);
+    Lexer::GetPosition(text, m_Result.offset, m_Result.line, m_Result.column);
+    return false;
+  }
+
+} // namespace json
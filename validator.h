@@ -0,0 +1,77 @@
+#pragma once
+
+#include "json.h"
+
+#include <bitset>
+#include <cstddef>
+#include <string_view>
+
+namespace json
+{
+  /**
+   * @brief Checks that a text is valid json (RFC 8259) without building anything or allocating. The grammar is run as a
+   * loop over the bytes with the kinds of the open containers kept in a fixed size bit stack, so deeply nested input
+   * can not overflow the call stack. Strings are checked for escape sequences, control characters and UTF-8.
+   */
+  class Validator
+  {
+  public:
+    /**
+     * @brief Deepest nesting of arrays and objects that is accepted.
+     */
+    static constexpr std::size_t MaxDepth = 64 * 1024;
+
+    /**
+     * @brief Construct a new Validator object
+     *
+     * @param text The json text.
+     */
+    Validator(std::string_view text);
+
+    /**
+     * @brief Validates the text. The position of the first error is reported in the result.
+     *
+     * @return ValidationResult
+     */
+    ValidationResult validate();
+
+  private:
+    /**
+     * @brief Runs the grammar over the whole text. Returns false at the first error.
+     */
+    bool validateJson();
+
+    /**
+     * @brief Checks the string starting at the opening quote at m_Pos and moves past its closing quote.
+     */
+    bool validateString();
+
+    /**
+     * @brief Checks the number starting at m_Pos and moves past it.
+     */
+    bool validateNumber();
+
+    /**
+     * @brief Checks that the literal starts at m_Pos and moves past it.
+     */
+    bool validateLiteral(const char* literal, std::size_t length);
+
+    void skipWhitespace();
+
+    /**
+     * @brief Records an error at the position and returns false.
+     *
+     * @param position Where the error is.
+     * @param expected What the grammar expected there.
+     */
+    bool fail(const char* position, const char* expected);
+
+  private:
+    const char* m_Begin;
+    const char* m_End;
+    const char* m_Pos;
+    std::bitset<MaxDepth> m_IsObject; // kind of every open container, outermost first
+    ValidationResult m_Result;
+  };
+
+} // namespace json